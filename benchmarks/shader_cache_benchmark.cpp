@@ -0,0 +1,468 @@
+#include "../shader_cache.hpp"
+#include "sbpt_generated_includes.hpp"
+
+#ifdef SHADER_CACHE_BENCHMARK_OSMESA
+#include <GL/osmesa.h>
+#else
+#include <EGL/egl.h>
+#endif
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+
+/**
+ * \brief measures the hot paths of ShaderCache so that changes to them can be compared against numbers
+ *
+ * \details every benchmark runs on a headless context, EGL with a pbuffer by default, or OSMesa when built with
+ * SHADER_CACHE_BENCHMARK_OSMESA defined for machines without a gpu. What gets measured is the cpu side cost of each
+ * call, a glFinish at the end of every run keeps queued driver work from leaking into the next one.
+ *
+ * The "old path" runs repeat in plain gl what the cache originally did for every call, binding the program and looking
+ * the location up by name each time, so every run reports its own reference point. Built with
+ * SHADER_CACHE_BENCHMARK_BASELINE defined only the interface the cache started out with is used, so the same file can
+ * be built against an older checkout to compare the cache itself. See CMakeLists.txt next to this file for the build.
+ *
+ * \usage shader_cache_benchmark [iterations], run it from the directory the shader catalog paths are relative to, every
+ * shader in the catalog gets built
+ */
+
+namespace {
+
+#ifdef SHADER_CACHE_BENCHMARK_OSMESA
+struct HeadlessContext {
+    OSMesaContext context = nullptr;
+    std::vector<unsigned char> buffer = std::vector<unsigned char>(4);
+};
+
+bool create_headless_context(HeadlessContext &headless_context) {
+    const int attributes[] = {OSMESA_FORMAT, OSMESA_RGBA, OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+                              OSMESA_CONTEXT_MAJOR_VERSION, 4, OSMESA_CONTEXT_MINOR_VERSION, 5, 0};
+    headless_context.context = OSMesaCreateContextAttribs(attributes, nullptr);
+    if (headless_context.context == nullptr or
+        not OSMesaMakeCurrent(headless_context.context, headless_context.buffer.data(), GL_UNSIGNED_BYTE, 1, 1)) {
+        return false;
+    }
+    return gladLoadGLLoader(reinterpret_cast<GLADloadproc>(OSMesaGetProcAddress));
+}
+
+void destroy_headless_context(HeadlessContext &headless_context) {
+    if (headless_context.context != nullptr) {
+        OSMesaDestroyContext(headless_context.context);
+    }
+}
+#else
+struct HeadlessContext {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLSurface surface = EGL_NO_SURFACE;
+    EGLContext context = EGL_NO_CONTEXT;
+};
+
+bool create_headless_context(HeadlessContext &headless_context) {
+    headless_context.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (headless_context.display == EGL_NO_DISPLAY or
+        not eglInitialize(headless_context.display, nullptr, nullptr)) {
+        return false;
+    }
+
+    const EGLint config_attributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                        EGL_NONE};
+    EGLConfig config;
+    EGLint config_count = 0;
+    if (not eglChooseConfig(headless_context.display, config_attributes, &config, 1, &config_count) or
+        config_count == 0) {
+        return false;
+    }
+
+    const EGLint surface_attributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    headless_context.surface = eglCreatePbufferSurface(headless_context.display, config, surface_attributes);
+    eglBindAPI(EGL_OPENGL_API);
+
+    // the newest core context we can get, so the direct state access paths can be measured too
+    for (EGLint minor_version : {6, 5, 3}) {
+        EGLint major_version = minor_version == 3 ? 3 : 4;
+        const EGLint context_attributes[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                             major_version,
+                                             EGL_CONTEXT_MINOR_VERSION,
+                                             minor_version,
+                                             EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                             EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                             EGL_NONE};
+        headless_context.context =
+            eglCreateContext(headless_context.display, config, EGL_NO_CONTEXT, context_attributes);
+        if (headless_context.context != EGL_NO_CONTEXT) {
+            break;
+        }
+    }
+    if (headless_context.context == EGL_NO_CONTEXT or
+        not eglMakeCurrent(headless_context.display, headless_context.surface, headless_context.surface,
+                           headless_context.context)) {
+        return false;
+    }
+    return gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress));
+}
+
+void destroy_headless_context(HeadlessContext &headless_context) {
+    if (headless_context.display == EGL_NO_DISPLAY) {
+        return;
+    }
+    eglMakeCurrent(headless_context.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (headless_context.context != EGL_NO_CONTEXT) {
+        eglDestroyContext(headless_context.display, headless_context.context);
+    }
+    if (headless_context.surface != EGL_NO_SURFACE) {
+        eglDestroySurface(headless_context.display, headless_context.surface);
+    }
+    eglTerminate(headless_context.display);
+}
+#endif
+
+/**
+ * \brief runs the operation a few times to warm up and then times it, the operation gets the iteration index so it can
+ * change the values it writes
+ */
+void run_benchmark(const std::string &name, std::size_t iterations, const std::function<void(std::size_t)> &operation) {
+    for (std::size_t i = 0; i < std::min<std::size_t>(iterations / 10, 1000); i++) {
+        operation(i);
+    }
+    glFinish();
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; i++) {
+        operation(i);
+    }
+    glFinish();
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::left << std::setw(64) << name << std::right << std::setw(12) << std::fixed
+              << std::setprecision(1) << elapsed / static_cast<double>(iterations) << " ns/op" << std::endl;
+}
+
+/**
+ * \brief an active uniform of some shader, found by asking the driver for its type so the matching overload is used
+ */
+struct UniformTarget {
+    ShaderType type;
+    ShaderUniformVariable uniform;
+};
+
+std::optional<UniformTarget> find_uniform_of_gl_type(ShaderCache &shader_cache, const std::vector<ShaderType> &types,
+                                                     GLenum gl_type) {
+    for (ShaderType type : types) {
+        GLuint program = shader_cache.get_shader_program(type).id;
+        for (const auto &[uniform, name] : shader_cache.shader_standard.shader_uniform_variable_to_name) {
+            const char *uniform_name = name.c_str();
+            GLuint index = GL_INVALID_INDEX;
+            glGetUniformIndices(program, 1, &uniform_name, &index);
+            if (index == GL_INVALID_INDEX) {
+                continue;
+            }
+            std::array<GLchar, 256> active_name{};
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum active_type = GL_NONE;
+            glGetActiveUniform(program, index, static_cast<GLsizei>(active_name.size()), &length, &size, &active_type,
+                               active_name.data());
+            if (active_type == gl_type and size == 1) {
+                return UniformTarget{type, uniform};
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+std::string get_configuration_name([[maybe_unused]] ShaderCache &shader_cache, [[maybe_unused]] ShaderType type) {
+#ifdef SHADER_CACHE_BENCHMARK_BASELINE
+    return "baseline interface";
+#else
+    std::string upload_mode = shader_cache.is_direct_state_access_enabled() ? "direct state access" : "bind and set";
+    return upload_mode + (shader_cache.is_uniform_shadowing_enabled(type) ? ", shadowed" : "");
+#endif
+}
+
+/**
+ * \brief every set_uniform overload once with a value that changes each call so that uniform shadowing can't skip it,
+ * and once writing the same value over and over which is what shadowing is there for
+ */
+void benchmark_set_uniform(ShaderCache &shader_cache, const std::vector<ShaderType> &types, std::size_t iterations) {
+    auto benchmark_overload = [&](const std::string &overload, GLenum gl_type,
+                                  const std::function<void(const UniformTarget &, float)> &set) {
+        std::optional<UniformTarget> target = find_uniform_of_gl_type(shader_cache, types, gl_type);
+        if (not target) {
+            std::cout << std::left << std::setw(64) << "set_uniform " + overload << "  no uniform of this type"
+                      << std::endl;
+            return;
+        }
+        std::string suffix = " (" + get_configuration_name(shader_cache, target->type) + ")";
+        shader_cache.use_shader_program(target->type);
+        run_benchmark("set_uniform " + overload + suffix, iterations,
+                      [&](std::size_t i) { set(*target, static_cast<float>(i)); });
+        run_benchmark("set_uniform " + overload + " repeated value" + suffix, iterations,
+                      [&](std::size_t) { set(*target, 1.0f); });
+    };
+
+    benchmark_overload("bool", GL_BOOL, [&](const UniformTarget &target, float value) {
+        shader_cache.set_uniform(target.type, target.uniform, static_cast<int>(value) % 2 == 0);
+    });
+    benchmark_overload("int", GL_INT, [&](const UniformTarget &target, float value) {
+        shader_cache.set_uniform(target.type, target.uniform, static_cast<int>(value));
+    });
+    benchmark_overload("float", GL_FLOAT, [&](const UniformTarget &target, float value) {
+        shader_cache.set_uniform(target.type, target.uniform, value);
+    });
+    benchmark_overload("vec2", GL_FLOAT_VEC2, [&](const UniformTarget &target, float value) {
+        shader_cache.set_uniform(target.type, target.uniform, glm::vec2(value));
+    });
+    benchmark_overload("float x, y", GL_FLOAT_VEC2, [&](const UniformTarget &target, float value) {
+        shader_cache.set_uniform(target.type, target.uniform, value, value);
+    });
+    benchmark_overload("vec3", GL_FLOAT_VEC3, [&](const UniformTarget &target, float value) {
+        shader_cache.set_uniform(target.type, target.uniform, glm::vec3(value));
+    });
+    benchmark_overload("float x, y, z", GL_FLOAT_VEC3, [&](const UniformTarget &target, float value) {
+        shader_cache.set_uniform(target.type, target.uniform, value, value, value);
+    });
+    benchmark_overload("vec4", GL_FLOAT_VEC4, [&](const UniformTarget &target, float value) {
+        shader_cache.set_uniform(target.type, target.uniform, glm::vec4(value));
+    });
+    benchmark_overload("float x, y, z, w", GL_FLOAT_VEC4, [&](const UniformTarget &target, float value) {
+        shader_cache.set_uniform(target.type, target.uniform, value, value, value, value);
+    });
+    std::vector<glm::vec4> values(1);
+    benchmark_overload("std::vector<vec4>", GL_FLOAT_VEC4, [&](const UniformTarget &target, float value) {
+        values[0] = glm::vec4(value);
+        shader_cache.set_uniform(target.type, target.uniform, values);
+    });
+    benchmark_overload("mat2", GL_FLOAT_MAT2, [&](const UniformTarget &target, float value) {
+        shader_cache.set_uniform(target.type, target.uniform, glm::mat2(value));
+    });
+    benchmark_overload("mat3", GL_FLOAT_MAT3, [&](const UniformTarget &target, float value) {
+        shader_cache.set_uniform(target.type, target.uniform, glm::mat3(value));
+    });
+    benchmark_overload("mat4", GL_FLOAT_MAT4, [&](const UniformTarget &target, float value) {
+        shader_cache.set_uniform(target.type, target.uniform, glm::mat4(value));
+    });
+}
+
+/**
+ * \brief what set_uniform originally cost, the program is bound and the location looked up by name on every call
+ * before the upload, done in plain gl so that it doesn't depend on how the cache works now
+ */
+void benchmark_old_set_uniform_path(ShaderCache &shader_cache, const std::vector<ShaderType> &types,
+                                    std::size_t iterations) {
+    auto benchmark_upload = [&](const std::string &uniform_type, GLenum gl_type,
+                                const std::function<void(GLint, float)> &upload) {
+        std::optional<UniformTarget> target = find_uniform_of_gl_type(shader_cache, types, gl_type);
+        if (not target) {
+            std::cout << std::left << std::setw(64) << "old path set_uniform " + uniform_type
+                      << "  no uniform of this type" << std::endl;
+            return;
+        }
+        GLuint program = shader_cache.get_shader_program(target->type).id;
+        const std::string &name = shader_cache.shader_standard.shader_uniform_variable_to_name.at(target->uniform);
+        run_benchmark("old path set_uniform " + uniform_type + " (bind, look up, upload)", iterations,
+                      [&](std::size_t i) {
+                          glUseProgram(program);
+                          GLint location = glGetUniformLocation(program, name.c_str());
+                          if (location != -1) {
+                              upload(location, static_cast<float>(i));
+                          }
+                      });
+    };
+
+    benchmark_upload("int", GL_INT,
+                     [](GLint location, float value) { glUniform1i(location, static_cast<int>(value)); });
+    benchmark_upload("float", GL_FLOAT, [](GLint location, float value) { glUniform1f(location, value); });
+    benchmark_upload("vec2", GL_FLOAT_VEC2, [](GLint location, float value) {
+        glm::vec2 vec(value);
+        glUniform2fv(location, 1, &vec[0]);
+    });
+    benchmark_upload("vec3", GL_FLOAT_VEC3, [](GLint location, float value) {
+        glm::vec3 vec(value);
+        glUniform3fv(location, 1, &vec[0]);
+    });
+    benchmark_upload("vec4", GL_FLOAT_VEC4, [](GLint location, float value) {
+        glm::vec4 vec(value);
+        glUniform4fv(location, 1, &vec[0]);
+    });
+    benchmark_upload("mat2", GL_FLOAT_MAT2, [](GLint location, float value) {
+        glm::mat2 mat(value);
+        glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
+    });
+    benchmark_upload("mat3", GL_FLOAT_MAT3, [](GLint location, float value) {
+        glm::mat3 mat(value);
+        glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+    });
+    benchmark_upload("mat4", GL_FLOAT_MAT4, [](GLint location, float value) {
+        glm::mat4 mat(value);
+        glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+    });
+
+    // the original use_shader_program issued glUseProgram every time, even for the program that was already bound
+    std::vector<GLuint> programs;
+    for (ShaderType type : types) {
+        programs.push_back(shader_cache.get_shader_program(type).id);
+    }
+    run_benchmark("old path use_shader_program switching (" + std::to_string(types.size()) + " shaders)", iterations,
+                  [&](std::size_t i) { glUseProgram(programs[i % programs.size()]); });
+    run_benchmark("old path use_shader_program already bound", iterations,
+                  [&](std::size_t) { glUseProgram(programs.front()); });
+    glUseProgram(0);
+}
+
+/**
+ * \brief switching between every shader in turn, and binding the one that is already bound which should be skipped
+ */
+void benchmark_use_shader_program(ShaderCache &shader_cache, const std::vector<ShaderType> &types,
+                                  std::size_t iterations) {
+    // the benchmarks before this may have bound programs behind the cache's back
+    shader_cache.stop_using_shader_program();
+    std::string suffix = " (" + std::to_string(types.size()) + " shaders)";
+    run_benchmark("use_shader_program switching" + suffix, iterations,
+                  [&](std::size_t i) { shader_cache.use_shader_program(types[i % types.size()]); });
+
+    shader_cache.use_shader_program(types.front());
+    run_benchmark("use_shader_program already bound", iterations,
+                  [&](std::size_t) { shader_cache.use_shader_program(types.front()); });
+}
+
+/**
+ * \brief configuring a vao for every attribute each shader uses, which is the setup cost paid per drawable
+ */
+void benchmark_configure_vertex_attributes(ShaderCache &shader_cache, const std::vector<ShaderType> &types,
+                                           std::size_t iterations) {
+    GLuint vertex_attribute_object, vertex_buffer_object;
+    glGenVertexArrays(1, &vertex_attribute_object);
+    glGenBuffers(1, &vertex_buffer_object);
+
+    for (ShaderType type : types) {
+        std::vector<ShaderVertexAttributeVariable> attributes =
+            shader_cache.get_used_vertex_attribute_variables_for_shader(type);
+        if (attributes.empty()) {
+            continue;
+        }
+        std::string name = shader_cache.shader_standard.shader_type_to_name.at(type);
+        run_benchmark("configure_vertex_attributes_for_drawables_vao " + name, iterations / 10 + 1,
+                      [&](std::size_t) {
+                          for (ShaderVertexAttributeVariable attribute : attributes) {
+                              shader_cache.configure_vertex_attributes_for_drawables_vao(
+                                  vertex_attribute_object, vertex_buffer_object, type, attribute);
+                          }
+                      });
+    }
+
+    glDeleteBuffers(1, &vertex_buffer_object);
+    glDeleteVertexArrays(1, &vertex_attribute_object);
+}
+
+/**
+ * \brief building the whole catalog with an empty binary cache and then again once the binary cache has been filled,
+ * note that the driver may keep its own shader cache so the cold number is only truly cold on the first run. The
+ * baseline interface has no binary cache, there the second construction only benefits from the driver's cache
+ */
+void benchmark_construction(const std::vector<ShaderType> &types) {
+#ifndef SHADER_CACHE_BENCHMARK_BASELINE
+    std::filesystem::path binary_cache_directory =
+        std::filesystem::temp_directory_path() / "shader_cache_benchmark_binaries";
+    std::filesystem::remove_all(binary_cache_directory);
+
+    ShaderCacheOptions options;
+    options.program_binary_cache_directory = binary_cache_directory.string();
+#endif
+
+    auto time_construction = [&](const std::string &name) {
+        auto start = std::chrono::steady_clock::now();
+        {
+#ifdef SHADER_CACHE_BENCHMARK_BASELINE
+            ShaderCache shader_cache(types);
+#else
+            ShaderCache shader_cache(types, {}, options);
+#endif
+            glFinish();
+        }
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << std::left << std::setw(64) << name << std::right << std::setw(12) << std::fixed
+                  << std::setprecision(3) << elapsed << " ms" << std::endl;
+    };
+
+    time_construction("construction cold (" + std::to_string(types.size()) + " shaders)");
+    time_construction("construction warm (" + std::to_string(types.size()) + " shaders)");
+
+#ifndef SHADER_CACHE_BENCHMARK_BASELINE
+    std::filesystem::remove_all(binary_cache_directory);
+#endif
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    if (iterations == 0) {
+        std::cerr << "usage: " << argv[0] << " [iterations]" << std::endl;
+        return 1;
+    }
+
+    HeadlessContext headless_context;
+    if (not create_headless_context(headless_context)) {
+        std::cerr << "failed to create a headless opengl context" << std::endl;
+        destroy_headless_context(headless_context);
+        return 1;
+    }
+    std::cout << "renderer: " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << std::endl;
+
+    std::vector<ShaderType> types;
+    for (const auto &[type, creation_info] : ShaderStandard().shader_catalog) {
+        types.push_back(type);
+    }
+    if (types.empty()) {
+        std::cerr << "the shader catalog is empty, there is nothing to measure" << std::endl;
+        destroy_headless_context(headless_context);
+        return 1;
+    }
+
+    try {
+        benchmark_construction(types);
+
+#ifdef SHADER_CACHE_BENCHMARK_BASELINE
+        {
+            ShaderCache shader_cache(types);
+            benchmark_set_uniform(shader_cache, types, iterations);
+        }
+#else
+        for (UniformUploadMode upload_mode :
+             {UniformUploadMode::BIND_AND_SET, UniformUploadMode::DIRECT_STATE_ACCESS}) {
+            ShaderCacheOptions options;
+            options.uniform_upload_mode = upload_mode;
+            ShaderCache shader_cache(types, {}, options);
+            if (upload_mode == UniformUploadMode::DIRECT_STATE_ACCESS and
+                not shader_cache.is_direct_state_access_enabled()) {
+                std::cout << "direct state access is not supported, skipping it" << std::endl;
+                continue;
+            }
+            for (bool uniform_shadowing_enabled : {false, true}) {
+                for (ShaderType type : types) {
+                    shader_cache.set_uniform_shadowing_enabled(type, uniform_shadowing_enabled);
+                }
+                benchmark_set_uniform(shader_cache, types, iterations);
+            }
+        }
+#endif
+
+        ShaderCache shader_cache(types);
+        benchmark_old_set_uniform_path(shader_cache, types, iterations);
+        benchmark_use_shader_program(shader_cache, types, iterations);
+        benchmark_configure_vertex_attributes(shader_cache, types, iterations);
+    } catch (const std::exception &exception) {
+        std::cerr << "benchmark failed: " << exception.what() << std::endl;
+        destroy_headless_context(headless_context);
+        return 1;
+    }
+
+    destroy_headless_context(headless_context);
+    return 0;
+}
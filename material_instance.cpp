@@ -0,0 +1,94 @@
+#include "material_instance.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+#include <glm/gtc/type_ptr.hpp>
+
+namespace {
+std::atomic<std::uint64_t> next_material_instance_id{1};
+}
+
+MaterialInstance::MaterialInstance(ShaderCache &shader_cache, ShaderType type)
+    : shader_cache(&shader_cache), type(type), id(next_material_instance_id.fetch_add(1)) {}
+
+void MaterialInstance::set_uniform(ShaderUniformVariable uniform, bool value) {
+    set_uniform(uniform, static_cast<int>(value));
+}
+
+void MaterialInstance::set_uniform(ShaderUniformVariable uniform, int value) {
+    set_value(uniform, UniformValueType::INT, &value, 1);
+}
+
+void MaterialInstance::set_uniform(ShaderUniformVariable uniform, float value) {
+    set_value(uniform, UniformValueType::FLOAT, &value, 1);
+}
+
+void MaterialInstance::set_uniform(ShaderUniformVariable uniform, const glm::vec2 &vec) {
+    set_value(uniform, UniformValueType::VEC2, &vec[0], 1);
+}
+
+void MaterialInstance::set_uniform(ShaderUniformVariable uniform, const glm::vec3 &vec) {
+    set_value(uniform, UniformValueType::VEC3, &vec[0], 1);
+}
+
+void MaterialInstance::set_uniform(ShaderUniformVariable uniform, const glm::vec4 &vec) {
+    set_value(uniform, UniformValueType::VEC4, &vec[0], 1);
+}
+
+void MaterialInstance::set_uniform(ShaderUniformVariable uniform, const std::vector<glm::vec4> &values) {
+    if (values.empty()) {
+        return;
+    }
+    set_value(uniform, UniformValueType::VEC4, glm::value_ptr(values[0]), static_cast<GLsizei>(values.size()));
+}
+
+void MaterialInstance::set_uniform(ShaderUniformVariable uniform, const glm::mat2 &mat) {
+    set_value(uniform, UniformValueType::MAT2, &mat[0][0], 1);
+}
+
+void MaterialInstance::set_uniform(ShaderUniformVariable uniform, const glm::mat3 &mat) {
+    set_value(uniform, UniformValueType::MAT3, &mat[0][0], 1);
+}
+
+void MaterialInstance::set_uniform(ShaderUniformVariable uniform, const glm::mat4 &mat) {
+    set_value(uniform, UniformValueType::MAT4, &mat[0][0], 1);
+}
+
+/**
+ * \brief binds the program of the material and uploads the values that need it, see
+ * ShaderCache::apply_material_instance
+ */
+void MaterialInstance::apply() { shader_cache->apply_material_instance(*this); }
+
+ShaderType MaterialInstance::get_shader_type() const { return type; }
+
+/**
+ * \brief a material only has a handful of uniforms, so finding one is a scan over a flat array
+ */
+void MaterialInstance::set_value(ShaderUniformVariable uniform, UniformValueType value_type, const void *data,
+                                 GLsizei count) {
+    std::size_t size = uniform_value_type_size(value_type) * static_cast<std::size_t>(count);
+
+    for (Entry &entry : entries) {
+        if (entry.uniform != uniform) {
+            continue;
+        }
+        if (entry.value_type != value_type or entry.count != count) {
+            throw std::runtime_error("A material uniform can't change its type or array size once it has been set");
+        }
+        unsigned char *stored = values.data() + entry.offset;
+        if (std::memcmp(stored, data, size) != 0) {
+            std::memcpy(stored, data, size);
+            entry.dirty = true;
+        }
+        return;
+    }
+
+    std::size_t offset = values.size();
+    values.resize(offset + size);
+    std::memcpy(values.data() + offset, data, size);
+    entries.push_back({uniform, shader_cache->get_uniform_location(type, uniform), value_type, count,
+                       static_cast<std::uint32_t>(offset), true});
+}
@@ -0,0 +1,68 @@
+#ifndef MATERIAL_INSTANCE_HPP
+#define MATERIAL_INSTANCE_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "shader_cache.hpp"
+
+/**
+ * \brief the uniform values for one material of a shader type, applied in one go with apply
+ *
+ * \details the location of a uniform is looked up once, the first time it is set, and the values are packed back to
+ * back in a single buffer. apply binds the program and only uploads the values that changed since the last apply,
+ * unless another material or a plain set_uniform touched the program in between, then all of them are uploaded again.
+ * If the program gets rebuilt, by a hot reload or because a different variant got selected, the locations are looked
+ * up again on the next apply
+ *
+ * \pre the program for the type has been created before the first set
+ * \usage set up a material once when loading, then call apply before drawing with it
+ */
+class MaterialInstance {
+  public:
+    MaterialInstance(ShaderCache &shader_cache, ShaderType type);
+
+    void set_uniform(ShaderUniformVariable uniform, bool value);
+    void set_uniform(ShaderUniformVariable uniform, int value);
+    void set_uniform(ShaderUniformVariable uniform, float value);
+    void set_uniform(ShaderUniformVariable uniform, const glm::vec2 &vec);
+    void set_uniform(ShaderUniformVariable uniform, const glm::vec3 &vec);
+    void set_uniform(ShaderUniformVariable uniform, const glm::vec4 &vec);
+    void set_uniform(ShaderUniformVariable uniform, const std::vector<glm::vec4> &values);
+    void set_uniform(ShaderUniformVariable uniform, const glm::mat2 &mat);
+    void set_uniform(ShaderUniformVariable uniform, const glm::mat3 &mat);
+    void set_uniform(ShaderUniformVariable uniform, const glm::mat4 &mat);
+
+    void apply();
+    ShaderType get_shader_type() const;
+
+  private:
+    friend class ShaderCache;
+
+    struct Entry {
+        ShaderUniformVariable uniform;
+        GLint location;
+        UniformValueType value_type;
+        GLsizei count;
+        /// where the value starts in values
+        std::uint32_t offset;
+        bool dirty;
+    };
+
+    void set_value(ShaderUniformVariable uniform, UniformValueType value_type, const void *data, GLsizei count);
+
+    ShaderCache *shader_cache;
+    ShaderType type;
+    /// unique for every material ever created, the cache remembers which one was applied to a program last
+    std::uint64_t id;
+    /// the CachedShaderProgram::build_id of the program the locations were last checked against, 0 before the first
+    /// apply
+    std::uint64_t program_build_id = 0;
+    std::vector<Entry> entries;
+    std::vector<unsigned char> values;
+};
+
+#endif // MATERIAL_INSTANCE_HPP
@@ -0,0 +1,234 @@
+#include "shader_archive.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SHADER_ARCHIVE_USE_MMAP
+#endif
+
+namespace {
+
+constexpr char archive_magic[4] = {'S', 'C', 'A', 'R'};
+constexpr std::uint32_t archive_version = 1;
+
+template <typename T> void write_integer(std::ofstream &file, T value) {
+    unsigned char bytes[sizeof(T)];
+    for (std::size_t i = 0; i < sizeof(T); i++) {
+        bytes[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+    file.write(reinterpret_cast<const char *>(bytes), sizeof(T));
+}
+
+template <typename T> bool read_integer(const char *data, std::size_t size, std::size_t &cursor, T &value) {
+    if (cursor + sizeof(T) > size) {
+        return false;
+    }
+    value = 0;
+    for (std::size_t i = 0; i < sizeof(T); i++) {
+        value |= static_cast<T>(static_cast<unsigned char>(data[cursor + i])) << (8 * i);
+    }
+    cursor += sizeof(T);
+    return true;
+}
+
+} // namespace
+
+ShaderArchive::~ShaderArchive() { close(); }
+
+/**
+ * \return false if the archive can't be read or is malformed, in which case nothing is loaded
+ */
+bool ShaderArchive::open(const std::string &archive_path) {
+    close();
+
+#ifdef SHADER_ARCHIVE_USE_MMAP
+    int file_descriptor = ::open(archive_path.c_str(), O_RDONLY);
+    if (file_descriptor != -1) {
+        struct stat file_status;
+        if (fstat(file_descriptor, &file_status) == 0 and file_status.st_size > 0) {
+            std::size_t mapping_size = static_cast<std::size_t>(file_status.st_size);
+            void *mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+            if (mapping != MAP_FAILED) {
+                data = static_cast<const char *>(mapping);
+                size = mapping_size;
+                memory_mapped = true;
+            }
+        }
+        ::close(file_descriptor);
+    }
+#endif
+
+    if (not memory_mapped) {
+        std::ifstream archive_file(archive_path, std::ios::binary | std::ios::ate);
+        if (not archive_file) {
+            return false;
+        }
+        contents.resize(static_cast<std::size_t>(archive_file.tellg()));
+        archive_file.seekg(0);
+        archive_file.read(contents.data(), static_cast<std::streamsize>(contents.size()));
+        if (not archive_file) {
+            contents.clear();
+            return false;
+        }
+        data = contents.data();
+        size = contents.size();
+    }
+
+    std::size_t cursor = 0;
+    std::uint32_t version = 0;
+    std::uint32_t entry_count = 0;
+    bool valid = size >= sizeof(archive_magic) and std::memcmp(data, archive_magic, sizeof(archive_magic)) == 0;
+    cursor += sizeof(archive_magic);
+    valid = valid and read_integer(data, size, cursor, version) and version == archive_version and
+            read_integer(data, size, cursor, entry_count);
+
+    for (std::uint32_t i = 0; valid and i < entry_count; i++) {
+        std::uint32_t path_length = 0;
+        std::uint64_t offset = 0;
+        std::uint64_t entry_size = 0;
+        valid = read_integer(data, size, cursor, path_length) and read_integer(data, size, cursor, offset) and
+                read_integer(data, size, cursor, entry_size) and cursor + path_length <= size and
+                offset + entry_size <= size;
+        if (valid) {
+            std::string path(data + cursor, path_length);
+            cursor += path_length;
+            entries.emplace(std::move(path), std::string_view(data + offset, static_cast<std::size_t>(entry_size)));
+        }
+    }
+
+    if (not valid) {
+        close();
+    }
+    return valid;
+}
+
+bool ShaderArchive::is_open() const { return data != nullptr; }
+
+/**
+ * \return a view into the archive, valid for as long as the archive stays open
+ */
+std::optional<std::string_view> ShaderArchive::find(const std::string &path) const {
+    auto it = entries.find(normalize_path(path));
+    if (it == entries.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+/**
+ * \brief packs the given files into a new archive, they are stored under their normalized path
+ */
+bool ShaderArchive::write(const std::string &archive_path, const std::vector<std::string> &paths) {
+    std::vector<std::pair<std::string, std::string>> files;
+    for (const std::string &path : paths) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (not file) {
+            return false;
+        }
+        std::string file_contents(static_cast<std::size_t>(file.tellg()), '\0');
+        file.seekg(0);
+        file.read(file_contents.data(), static_cast<std::streamsize>(file_contents.size()));
+        files.emplace_back(normalize_path(path), std::move(file_contents));
+    }
+
+    std::uint64_t offset = sizeof(archive_magic) + 2 * sizeof(std::uint32_t);
+    for (const auto &[path, file_contents] : files) {
+        offset += sizeof(std::uint32_t) + 2 * sizeof(std::uint64_t) + path.size();
+    }
+
+    std::ofstream archive_file(archive_path, std::ios::binary | std::ios::trunc);
+    archive_file.write(archive_magic, sizeof(archive_magic));
+    write_integer(archive_file, archive_version);
+    write_integer(archive_file, static_cast<std::uint32_t>(files.size()));
+    for (const auto &[path, file_contents] : files) {
+        write_integer(archive_file, static_cast<std::uint32_t>(path.size()));
+        write_integer(archive_file, offset);
+        write_integer(archive_file, static_cast<std::uint64_t>(file_contents.size()));
+        archive_file.write(path.data(), static_cast<std::streamsize>(path.size()));
+        offset += file_contents.size();
+    }
+    for (const auto &[path, file_contents] : files) {
+        archive_file.write(file_contents.data(), static_cast<std::streamsize>(file_contents.size()));
+    }
+    return static_cast<bool>(archive_file);
+}
+
+/**
+ * \brief paths are looked up the way they are written in the shader catalog, this irons out "./" and "a/../b"
+ */
+std::string ShaderArchive::normalize_path(const std::string &path) {
+    return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+void ShaderArchive::close() {
+#ifdef SHADER_ARCHIVE_USE_MMAP
+    if (memory_mapped) {
+        munmap(const_cast<char *>(data), size);
+    }
+#endif
+    data = nullptr;
+    size = 0;
+    memory_mapped = false;
+    contents.clear();
+    entries.clear();
+}
+
+/**
+ * \return the quoted path if the line is an #include "file" directive
+ */
+std::optional<std::string> parse_shader_include_directive(std::string_view line) {
+    const std::string_view include_directive = "#include";
+    std::size_t first_character = line.find_first_not_of(" \t");
+    if (first_character == std::string_view::npos or
+        line.compare(first_character, include_directive.size(), include_directive) != 0) {
+        return std::nullopt;
+    }
+
+    std::size_t open_quote = line.find('"', first_character);
+    std::size_t close_quote = open_quote == std::string_view::npos ? open_quote : line.find('"', open_quote + 1);
+    if (close_quote == std::string_view::npos) {
+        return std::nullopt;
+    }
+    return std::string(line.substr(open_quote + 1, close_quote - open_quote - 1));
+}
+
+/**
+ * \brief the given files plus everything they include, so that an archive built from them is self contained
+ */
+std::vector<std::string> collect_shader_files_with_includes(const std::vector<std::string> &paths) {
+    std::vector<std::string> collected;
+    std::vector<std::string> to_visit;
+    for (const std::string &path : paths) {
+        to_visit.push_back(ShaderArchive::normalize_path(path));
+    }
+
+    while (not to_visit.empty()) {
+        std::string path = to_visit.back();
+        to_visit.pop_back();
+        if (std::find(collected.begin(), collected.end(), path) != collected.end()) {
+            continue;
+        }
+        collected.push_back(path);
+        // SPIR-V modules are binary and can't include anything
+        if (std::filesystem::path(path).extension() == ".spv") {
+            continue;
+        }
+
+        std::ifstream file(path);
+        std::string line;
+        std::filesystem::path directory = std::filesystem::path(path).parent_path();
+        while (std::getline(file, line)) {
+            if (std::optional<std::string> included = parse_shader_include_directive(line)) {
+                to_visit.push_back(ShaderArchive::normalize_path((directory / *included).string()));
+            }
+        }
+    }
+    return collected;
+}
@@ -0,0 +1,49 @@
+#ifndef SHADER_ARCHIVE_HPP
+#define SHADER_ARCHIVE_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \brief a single file that bundles many shader sources, so that startup opens one file instead of dozens
+ *
+ * \details the layout is a header of the magic "SCAR", a u32 version and a u32 entry count, then for every entry a u32
+ * path length, u64 offset, u64 size and the path itself, followed by the contents of all files back to back. Offsets
+ * are from the start of the archive, all integers are little endian. On posix systems the archive is memory mapped so
+ * looking up a file is free, elsewhere it is read in with a single read.
+ *
+ * \usage build one with tools/pack_shader_archive.cpp and point ShaderCacheOptions::shader_archive_path at it
+ */
+class ShaderArchive {
+  public:
+    ShaderArchive() = default;
+    ~ShaderArchive();
+    ShaderArchive(const ShaderArchive &) = delete;
+    ShaderArchive &operator=(const ShaderArchive &) = delete;
+
+    bool open(const std::string &archive_path);
+    bool is_open() const;
+    std::optional<std::string_view> find(const std::string &path) const;
+
+    static bool write(const std::string &archive_path, const std::vector<std::string> &paths);
+    static std::string normalize_path(const std::string &path);
+
+  private:
+    void close();
+
+    const char *data = nullptr;
+    std::size_t size = 0;
+    bool memory_mapped = false;
+    /// only used when the archive couldn't be memory mapped
+    std::vector<char> contents;
+    std::unordered_map<std::string, std::string_view> entries;
+};
+
+std::optional<std::string> parse_shader_include_directive(std::string_view line);
+std::vector<std::string> collect_shader_files_with_includes(const std::vector<std::string> &paths);
+
+#endif // SHADER_ARCHIVE_HPP
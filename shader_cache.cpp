@@ -1,4 +1,6 @@
 #include "shader_cache.hpp"
+#include "uniform_batch.hpp"
+#include "material_instance.hpp"
 #include "sbpt_generated_includes.hpp"
 
 #include <iostream>
@@ -7,379 +9,3517 @@
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <iomanip>
+#include <mutex>
 #include <sstream>
 
+// the counting compiles away entirely unless instrumentation is turned on, see ShaderCache::begin_frame
+#ifdef SHADER_CACHE_INSTRUMENTATION
+#define SHADER_CACHE_COUNT(type, counter) count_frame_event(type, &ShaderCacheFrameCounters::counter)
+#define SHADER_CACHE_COUNT_UNIFORM_UPLOAD(type, value_type) count_uniform_upload(type, value_type)
+#else
+#define SHADER_CACHE_COUNT(type, counter)
+#define SHADER_CACHE_COUNT_UNIFORM_UPLOAD(type, value_type)
+#endif
+
+/**
+ * \brief the time since start, in the unit that the build statistics use
+ */
+std::chrono::microseconds elapsed_microseconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+}
+
+std::chrono::microseconds ShaderProgramBuildStatistics::get_total_time() const {
+    std::chrono::microseconds total_time = source_read_time + link_time;
+    for (const ShaderStageBuildStatistics &stage : stages) {
+        total_time += stage.compile_time;
+    }
+    return total_time;
+}
+
 /**
  *
  * \pre there is an active opengl context, otherwise undefined behavior
  * \param requested_shaders out of the passed in which ones to actually create on instantiation
+ * \param options see ShaderCacheOptions, the defaults behave like a plain shader cache
  */
-ShaderCache::ShaderCache(std::vector<ShaderType> requested_shaders, const std::vector<spdlog::sink_ptr> &sinks) {
+ShaderCache::ShaderCache(std::vector<ShaderType> requested_shaders, const std::vector<spdlog::sink_ptr> &sinks,
+                         const ShaderCacheOptions &options) {
     if (not sinks.empty()) {
         logger_component = LoggerComponent("shader cache", sinks);
     }
 
-    for (const auto &shader_type : requested_shaders) {
-        create_shader_program(shader_type);
+    direct_state_access_enabled = resolve_direct_state_access(options.uniform_upload_mode);
+    program_binary_cache_enabled = initialize_program_binary_cache(options.program_binary_cache_directory);
+    hot_reload_enabled = options.hot_reload_enabled;
+    spirv_supported = GLAD_GL_VERSION_4_6 or GLAD_GL_ARB_gl_spirv;
+    spirv_specialization_constants = options.spirv_specialization_constants;
+    compute_shader_catalog = options.compute_shader_catalog;
+    separable_programs_enabled =
+        options.separable_programs and (GLAD_GL_VERSION_4_1 or GLAD_GL_ARB_separate_shader_objects);
+    if (options.separable_programs and not separable_programs_enabled and logger_component.logging_enabled) {
+        logger_component.get_logger()->warn("Separable programs are not supported, linking whole programs instead");
+    }
+    shader_variant_defines = options.shader_variant_defines;
+    max_cached_shader_variants = options.max_cached_shader_variants;
+    max_resident_shader_programs = options.max_resident_shader_programs;
+    resident_shader_program_byte_budget = options.resident_shader_program_byte_budget;
+    program_size_estimates_enabled =
+        resident_shader_program_byte_budget > 0 and (GLAD_GL_VERSION_4_1 or GLAD_GL_ARB_get_program_binary);
+    if (resident_shader_program_byte_budget > 0 and not program_size_estimates_enabled and
+        logger_component.logging_enabled) {
+        logger_component.get_logger()->warn(
+            "A shader program byte budget was given but program sizes can't be queried, it is ignored");
+    }
+    if (shader_variant_defines.size() > 32) {
+        throw std::runtime_error("A shader variant key can only hold 32 defines");
+    }
+
+    if (not options.shader_archive_path.empty() and not shader_archive.open(options.shader_archive_path) and
+        logger_component.logging_enabled) {
+        logger_component.get_logger()->error("Could not load the shader archive {}, reading shaders from disk",
+                                             options.shader_archive_path);
+    }
+    hot_reload_poll_interval = options.hot_reload_poll_interval;
+
+    std::size_t shader_type_table_size = 0;
+    for (const auto &[type, creation_info] : shader_standard.shader_catalog) {
+        shader_type_table_size = std::max(shader_type_table_size, static_cast<std::size_t>(type) + 1);
+    }
+    for (const auto &[type, compute_path] : compute_shader_catalog) {
+        shader_type_table_size = std::max(shader_type_table_size, static_cast<std::size_t>(type) + 1);
+    }
+    created_shaders.resize(shader_type_table_size);
+    created_shader_alive.resize(shader_type_table_size, false);
+    resident_shader_program_lru_positions.resize(shader_type_table_size);
+    resident_shader_program_sizes.resize(shader_type_table_size, 0);
+    selected_shader_variant_programs.resize(shader_type_table_size, nullptr);
+    selected_shader_variant_keys.resize(shader_type_table_size, 0);
+
+    for (const auto &[uniform, name] : shader_standard.shader_uniform_variable_to_name) {
+        uniform_name_to_variable.emplace(name, uniform);
+        uniform_location_table_size = std::max(uniform_location_table_size, static_cast<std::size_t>(uniform) + 1);
+    }
+    uniform_names.resize(uniform_location_table_size);
+    for (const auto &[uniform, name] : shader_standard.shader_uniform_variable_to_name) {
+        uniform_names[static_cast<std::size_t>(uniform)] = name;
+    }
+
+    for (const auto &[variable, name] : shader_standard.shader_vertex_attribute_variable_to_name) {
+        std::size_t index = static_cast<std::size_t>(variable);
+        if (index >= vertex_attribute_variable_names.size()) {
+            vertex_attribute_variable_names.resize(index + 1);
+        }
+        vertex_attribute_variable_names[index] = name;
+    }
+
+    bindless_texture_supported = GLAD_GL_ARB_bindless_texture;
+
+    gpu_profiling_enabled = options.gpu_profiling_enabled and (GLAD_GL_VERSION_3_3 or GLAD_GL_ARB_timer_query);
+    if (gpu_profiling_enabled) {
+        gpu_timer_queries.resize(std::max<std::size_t>(options.gpu_profiling_query_count, 1));
+        for (GpuTimerQuery &timer_query : gpu_timer_queries) {
+            glGenQueries(1, &timer_query.query);
+        }
+    } else if (options.gpu_profiling_enabled and logger_component.logging_enabled) {
+        logger_component.get_logger()->warn("Timer queries are not supported, gpu profiling is disabled");
+    }
+
+    parallel_shader_compile_supported = GLAD_GL_KHR_parallel_shader_compile;
+    if (parallel_shader_compile_supported) {
+        // let the driver decide how many of its threads to use
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+
+    switch (options.program_creation_mode) {
+    case ProgramCreationMode::IMMEDIATE:
+        create_shader_programs(requested_shaders);
+        break;
+    case ProgramCreationMode::ASYNCHRONOUS:
+        for (ShaderType type : requested_shaders) {
+            pending_shader_programs.emplace(type, submit_shader_program(type));
+        }
+        break;
+    case ProgramCreationMode::ON_FIRST_USE:
+        deferred_shader_types.insert(requested_shaders.begin(), requested_shaders.end());
+        break;
     }
+    prewarm_shader_variants(options.prewarmed_shader_variants);
     this->log_shader_program_info();
 }
 
 ShaderCache::~ShaderCache() {
-    for (auto &pair : created_shaders) {
-        glDeleteProgram(pair.second.id);
+    // the background reads capture this, so they have to be done before anything goes away
+    for (auto &[type, sources] : hot_reloads_in_flight) {
+        sources.wait();
+    }
+    for (std::size_t i = 0; i < created_shaders.size(); i++) {
+        if (created_shader_alive[i]) {
+            release_cached_shader_program(created_shaders[i]);
+        }
+    }
+    for (auto &[id, variant] : shader_variants) {
+        release_cached_shader_program(variant.program);
+    }
+    for (auto &[type, pending_program] : pending_shader_programs) {
+        glDeleteProgram(pending_program.program);
+    }
+    for (auto &[key, shader] : compiled_shader_objects) {
+        glDeleteShader(shader);
+    }
+    for (auto &[key, stage_program] : separable_stage_programs) {
+        glDeleteProgram(stage_program);
+    }
+    for (GLuint stage_program : retired_separable_stage_programs) {
+        glDeleteProgram(stage_program);
+    }
+    for (auto &[texture, handle] : resident_texture_handles) {
+        glMakeTextureHandleNonResidentARB(handle);
+    }
+    end_gpu_timer_query();
+    for (GpuTimerQuery &timer_query : gpu_timer_queries) {
+        glDeleteQueries(1, &timer_query.query);
+    }
+    for (SharedUniformBlock &block : shared_uniform_blocks) {
+        for (GLsync fence : block.slot_fences) {
+            if (fence) {
+                glDeleteSync(fence);
+            }
+        }
+        if (block.mapped) {
+            glBindBuffer(GL_UNIFORM_BUFFER, block.buffer);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &block.buffer);
+    }
+    for (InstanceDataBuffer &instance_buffer : instance_data_buffers) {
+        glDeleteBuffers(1, &instance_buffer.buffer);
     }
 }
 
 /**
- * \pre the requested shader program has been created
+ * \pre the requested shader program has been created, with a creation mode other than IMMEDIATE that means is_ready
+ * has returned true for it or it has been used already
  * \param type the type of shader to get
  * \return the id of the shader program
  */
-ShaderProgramInfo ShaderCache::get_shader_program(ShaderType type) const {
-    auto it = created_shaders.find(type);
-    if (it != created_shaders.end()) {
-        return it->second;
+const ShaderProgramInfo &ShaderCache::get_shader_program(ShaderType type) const {
+    return get_cached_shader_program(type).info;
+}
+
+bool ShaderCache::is_shader_program_created(ShaderType type) const {
+    std::size_t index = static_cast<std::size_t>(type);
+    return index < created_shader_alive.size() and created_shader_alive[index];
+}
+
+const CachedShaderProgram &ShaderCache::get_cached_shader_program(ShaderType type) const {
+    std::size_t index = static_cast<std::size_t>(type);
+    if (index < selected_shader_variant_programs.size() and selected_shader_variant_programs[index]) {
+        return *selected_shader_variant_programs[index];
+    }
+    if (is_shader_program_created(type)) {
+        return created_shaders[static_cast<std::size_t>(type)];
+    }
+    if (pending_shader_programs.count(type) or deferred_shader_types.count(type)) {
+        throw std::runtime_error("Shader program is not ready yet");
+    }
+    throw std::runtime_error("Shader program not found");
+}
+
+/**
+ * \brief unlike the const version this finishes programs that are still pending, waiting on the driver if it has to
+ */
+CachedShaderProgram &ShaderCache::get_cached_shader_program(ShaderType type) {
+    std::size_t index = static_cast<std::size_t>(type);
+    if (index < selected_shader_variant_programs.size() and selected_shader_variant_programs[index]) {
+        return *selected_shader_variant_programs[index];
+    }
+    if (is_shader_program_created(type) or advance_shader_program(type, true)) {
+        return created_shaders[static_cast<std::size_t>(type)];
     }
     throw std::runtime_error("Shader program not found");
 }
 
+/**
+ * \brief moves a program that isn't created yet along, deferred programs are submitted and pending ones finalized
+ *
+ * \param wait if false this never blocks, a pending program is only finalized once the driver reports that it is done,
+ * which it can only do with KHR_parallel_shader_compile
+ * \return true if the program is created after the call
+ */
+bool ShaderCache::advance_shader_program(ShaderType type, bool wait) {
+    if (is_shader_program_created(type)) {
+        return true;
+    }
+
+    auto pending_it = pending_shader_programs.find(type);
+    if (pending_it == pending_shader_programs.end()) {
+        auto deferred_it = deferred_shader_types.find(type);
+        if (deferred_it == deferred_shader_types.end()) {
+            return false;
+        }
+        deferred_shader_types.erase(deferred_it);
+        pending_it = pending_shader_programs.emplace(type, submit_shader_program(type)).first;
+    }
+
+    bool completion_known = parallel_shader_compile_supported or pending_it->second.loaded_from_binary;
+    if (not wait and (not completion_known or not is_shader_program_complete(pending_it->second))) {
+        return false;
+    }
+
+    finalize_shader_program(pending_it->second);
+    pending_shader_programs.erase(pending_it);
+    return true;
+}
+
+bool ShaderCache::is_compute_shader_program(ShaderType type) const { return compute_shader_catalog.count(type); }
+
+/**
+ * \brief the local size the compute shader declared, queried once when the program was linked
+ */
+const std::array<GLint, 3> &ShaderCache::get_compute_work_group_size(ShaderType type) const {
+    return get_cached_shader_program(type).compute_work_group_size;
+}
+
+/**
+ * \brief binds the compute program and dispatches the given number of work groups, set its uniforms through the
+ * cache as with any other program beforehand
+ *
+ * \note this doesn't issue a memory barrier, call glMemoryBarrier before reading what the shader wrote
+ */
+void ShaderCache::dispatch(ShaderType type, GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z) {
+    if (not is_compute_shader_program(type)) {
+        throw std::runtime_error("Only compute programs can be dispatched");
+    }
+    use_shader_program(type);
+    glDispatchCompute(num_groups_x, num_groups_y, num_groups_z);
+}
+
+/**
+ * \brief a non-blocking way to find out if a program can be used without waiting on the driver
+ *
+ * \details with ON_FIRST_USE the first call submits the program so that it starts building. Without
+ * KHR_parallel_shader_compile the driver can't be asked without blocking, so programs only become ready through
+ * poll_pending_shader_programs or by being used
+ */
+bool ShaderCache::is_ready(ShaderType type) { return advance_shader_program(type, false); }
+
+/**
+ * \brief finalizes the programs that the driver has finished, meant to be called once per frame while loading
+ *
+ * \details without KHR_parallel_shader_compile it can't be known which programs are done, so a single one is finished
+ * per call, this spreads the blocking out over frames
+ *
+ * \return the number of programs that are still pending
+ */
+std::size_t ShaderCache::poll_pending_shader_programs() {
+    for (auto it = pending_shader_programs.begin(); it != pending_shader_programs.end();) {
+        if (not is_shader_program_complete(it->second)) {
+            ++it;
+            continue;
+        }
+
+        finalize_shader_program(it->second);
+        it = pending_shader_programs.erase(it);
+
+        if (not parallel_shader_compile_supported) {
+            break;
+        }
+    }
+    return pending_shader_programs.size();
+}
+
+/**
+ * \brief binds the program for the given shader type, the glUseProgram call is skipped if it is already bound
+ *
+ * \details with separable programs enabled the type is a program pipeline, binding it unbinds any program since a
+ * bound program takes precedence over the bound pipeline
+ *
+ * \note the cache only knows about binds that go through it, if something else calls glUseProgram then tell the cache
+ * with invalidate_bound_program
+ */
 void ShaderCache::use_shader_program(ShaderType type) {
-    ShaderProgramInfo shader_info = get_shader_program(type);
+    const CachedShaderProgram &program = get_cached_shader_program(type);
+    if (program.pipeline != 0) {
+        // a bound program wins over the bound pipeline, so it has to be unbound for the pipeline to take effect
+        if (currently_bound_program == 0 and currently_bound_pipeline == program.pipeline) {
+            program_bind_statistics.skipped_binds++;
+            SHADER_CACHE_COUNT(type, skipped_program_binds);
+            return;
+        }
+        if (currently_bound_program != 0) {
+            glUseProgram(0);
+            currently_bound_program = 0;
+        }
+        if (currently_bound_pipeline != program.pipeline) {
+            glBindProgramPipeline(program.pipeline);
+            currently_bound_pipeline = program.pipeline;
+        }
+        program_bind_statistics.issued_binds++;
+        begin_gpu_timer_query(type);
+        touch_resident_shader_program(type);
+        SHADER_CACHE_COUNT(type, issued_program_binds);
+        return;
+    }
+
+    const ShaderProgramInfo &shader_info = program.info;
+    if (shader_info.id == currently_bound_program) {
+        program_bind_statistics.skipped_binds++;
+        SHADER_CACHE_COUNT(type, skipped_program_binds);
+        return;
+    }
+
     glUseProgram(shader_info.id);
+    currently_bound_program = shader_info.id;
+    program_bind_statistics.issued_binds++;
+    begin_gpu_timer_query(type);
+    touch_resident_shader_program(type);
+    SHADER_CACHE_COUNT(type, issued_program_binds);
 }
 
 void ShaderCache::print_out_active_uniforms_in_shader(ShaderType type) {
 
-    ShaderProgramInfo shader_info = get_shader_program(type);
-    GLint num_uniforms;
-    glGetProgramiv(shader_info.id, GL_ACTIVE_UNIFORMS, &num_uniforms);
-    for (GLint i = 0; i < num_uniforms; i++) {
-        char name[256];
-        GLsizei length;
-        glGetActiveUniform(shader_info.id, i, sizeof(name), &length, NULL, NULL, name);
-        std::cout << "Uniform " << i << ": " << name << std::endl;
+    for (GLuint program : get_linked_programs(get_cached_shader_program(type))) {
+        GLint num_uniforms;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &num_uniforms);
+        for (GLint i = 0; i < num_uniforms; i++) {
+            char name[256];
+            GLsizei length;
+            glGetActiveUniform(program, i, sizeof(name), &length, NULL, NULL, name);
+            std::cout << "Uniform " << i << ": " << name << std::endl;
+        }
+    }
+}
+
+/**
+ * \brief glProgramUniform* is core in 4.1 and otherwise comes with ARB_separate_shader_objects
+ */
+bool ShaderCache::resolve_direct_state_access(UniformUploadMode uniform_upload_mode) const {
+    bool supported = GLAD_GL_VERSION_4_1 or GLAD_GL_ARB_separate_shader_objects;
+
+    switch (uniform_upload_mode) {
+    case UniformUploadMode::BIND_AND_SET:
+        return false;
+    case UniformUploadMode::AUTOMATIC:
+        return supported;
+    case UniformUploadMode::DIRECT_STATE_ACCESS:
+        if (not supported and logger_component.logging_enabled) {
+            logger_component.get_logger()->warn(
+                "Direct state access uniforms were requested but glProgramUniform is not available, falling back to "
+                "binding the program before setting uniforms");
+        }
+        return supported;
     }
+    return false;
 }
 
-void ShaderCache::stop_using_shader_program() { glUseProgram(0); }
+bool ShaderCache::is_direct_state_access_enabled() const { return direct_state_access_enabled; }
 
-void ShaderCache::create_shader_program(ShaderType type) {
+void ShaderCache::stop_using_shader_program() {
+    end_gpu_timer_query();
+    glUseProgram(0);
+    currently_bound_program = 0;
+    if (currently_bound_pipeline != 0) {
+        glBindProgramPipeline(0);
+        currently_bound_pipeline = 0;
+    }
+}
 
-    bool logging = logger_component.logging_enabled;
-    auto logger = logger_component.get_logger();
+/**
+ * \brief forgets which program the cache thinks is bound, so the next use_shader_program call always binds
+ */
+void ShaderCache::invalidate_bound_program() {
+    currently_bound_program = 0;
+    currently_bound_pipeline = 0;
+}
+
+const ProgramBindStatistics &ShaderCache::get_program_bind_statistics() const { return program_bind_statistics; }
+
+void ShaderCache::reset_program_bind_statistics() { program_bind_statistics = ProgramBindStatistics(); }
+
+/**
+ * \brief creates a single program and waits for it, use create_shader_programs to create many at once
+ */
+void ShaderCache::create_shader_program(ShaderType type) { create_shader_programs({type}); }
+
+/**
+ * \brief submits every compile and link up front and only then waits on them, with KHR_parallel_shader_compile the
+ * driver builds all of the programs on its own threads in the meantime
+ *
+ * \details programs are finalized in the order they complete, when none of them is done yet the next one is waited on
+ * rather than spinning. Without the extension the first status query on each program blocks until it is done which is
+ * no worse than creating them one by one
+ */
+void ShaderCache::create_shader_programs(const std::vector<ShaderType> &types) {
+    std::vector<PendingShaderProgram> pending_programs;
+    pending_programs.reserve(types.size());
+    std::unordered_set<ShaderType> submitted_types;
+    for (ShaderType type : types) {
+        // a type listed twice is built once
+        if (is_shader_program_created(type) or not submitted_types.insert(type).second) {
+            continue;
+        }
+        // programs that are already on their way just get finished along with the rest
+        auto pending_it = pending_shader_programs.find(type);
+        if (pending_it != pending_shader_programs.end()) {
+            pending_programs.push_back(std::move(pending_it->second));
+            pending_shader_programs.erase(pending_it);
+            continue;
+        }
+        deferred_shader_types.erase(type);
+        pending_programs.push_back(submit_shader_program(type));
+    }
+
+    std::size_t remaining = pending_programs.size();
+    std::vector<bool> finalized(pending_programs.size(), false);
+    while (remaining > 0) {
+        bool made_progress = false;
+        for (std::size_t i = 0; i < pending_programs.size(); i++) {
+            if (finalized[i] or not is_shader_program_complete(pending_programs[i])) {
+                continue;
+            }
+            finalize_shader_program(pending_programs[i], false);
+            finalized[i] = true;
+            remaining--;
+            made_progress = true;
+        }
+
+        if (not made_progress) {
+            // finalizing queries the link status, which blocks until the driver is done with the program
+            std::size_t next = static_cast<std::size_t>(std::find(finalized.begin(), finalized.end(), false) -
+                                                        finalized.begin());
+            finalize_shader_program(pending_programs[next], false);
+            finalized[next] = true;
+            remaining--;
+        }
+    }
+
+    // evicting as each program is registered could throw out one that is part of this same batch, so the budget is
+    // only enforced once all of them are in
+    evict_resident_shader_programs(std::nullopt);
+}
+
+/**
+ * \brief reads the sources, loads the program from the binary cache if possible and otherwise issues the compiles and
+ * the link, no status is queried here so none of this waits on the driver
+ */
+ShaderCache::PendingShaderProgram ShaderCache::submit_shader_program(ShaderType type) {
+    return submit_shader_program(type, read_shader_stage_sources(type));
+}
+
+/**
+ * \brief reads the source of every stage of the shader from disk, only reads files so it is safe to call from a thread
+ * other than the one that owns the context
+ */
+std::vector<ShaderStageSource> ShaderCache::read_shader_stage_sources(ShaderType type,
+                                                                     ShaderVariantKey variant_key) const {
+    auto compute_it = compute_shader_catalog.find(type);
+    if (compute_it != compute_shader_catalog.end()) {
+        if (not(GLAD_GL_VERSION_4_3 or GLAD_GL_ARB_compute_shader)) {
+            throw std::runtime_error("Compute shaders are not supported by this context");
+        }
+        return {read_shader_stage_source(type, GL_COMPUTE_SHADER, compute_it->second, variant_key)};
+    }
 
     auto it = shader_standard.shader_catalog.find(type);
     if (it == shader_standard.shader_catalog.end()) {
         throw std::runtime_error("Shader type not found");
     }
 
+    const ShaderCreationInfo &shader_info = it->second;
+
+    std::vector<ShaderStageSource> stage_sources;
+    stage_sources.push_back(read_shader_stage_source(type, GL_VERTEX_SHADER, shader_info.vertex_path, variant_key));
+    stage_sources.push_back(
+        read_shader_stage_source(type, GL_FRAGMENT_SHADER, shader_info.fragment_path, variant_key));
+    if (!shader_info.geometry_path.empty()) {
+        stage_sources.push_back(
+            read_shader_stage_source(type, GL_GEOMETRY_SHADER, shader_info.geometry_path, variant_key));
+    }
+    return stage_sources;
+}
+
+/**
+ * \brief catalog paths ending in .spv are precompiled SPIR-V modules
+ */
+bool is_spirv_shader_path(const std::string &path) {
+    const std::string spirv_extension = ".spv";
+    return path.size() > spirv_extension.size() &&
+           path.compare(path.size() - spirv_extension.size(), spirv_extension.size(), spirv_extension) == 0;
+}
+
+/**
+ * \brief the file that actually gets loaded for a catalog path, if the context can't take SPIR-V the GLSL file it was
+ * compiled from is used instead, which is the same path without the .spv on the end
+ */
+std::string ShaderCache::resolve_shader_stage_path(const std::string &path) const {
+    if (is_spirv_shader_path(path) and not spirv_supported) {
+        return path.substr(0, path.size() - std::string(".spv").size());
+    }
+    return path;
+}
+
+ShaderStageSource ShaderCache::read_shader_stage_source(ShaderType type, GLenum stage, const std::string &path,
+                                                        ShaderVariantKey variant_key) const {
+    auto read_start = std::chrono::steady_clock::now();
+    std::string resolved_path = resolve_shader_stage_path(path);
+
+    ShaderStageSource stage_source;
+    stage_source.stage = stage;
+    stage_source.path = resolved_path;
+    stage_source.spirv = is_spirv_shader_path(resolved_path);
+
+    if (not stage_source.spirv) {
+        stage_source.source = get_shader_source(resolved_path);
+        if (variant_key != 0) {
+            stage_source.source = inject_shader_variant_defines(stage_source.source, variant_key);
+            stage_source.variant = "defines=" + std::to_string(variant_key);
+        }
+        stage_source.read_time = elapsed_microseconds(read_start);
+        return stage_source;
+    }
+
+    // SPIR-V is binary, so it must not go through include expansion
+    stage_source.source = get_raw_shader_source(resolved_path);
+    auto constants_it = spirv_specialization_constants.find(type);
+    if (constants_it != spirv_specialization_constants.end()) {
+        stage_source.specialization_constants = constants_it->second;
+        for (const SpecializationConstant &constant : constants_it->second) {
+            stage_source.variant += std::to_string(constant.constant_id) + "=" + std::to_string(constant.value) + ";";
+        }
+    }
+    stage_source.read_time = elapsed_microseconds(read_start);
+    return stage_source;
+}
+
+ShaderCache::PendingShaderProgram
+ShaderCache::submit_shader_program(ShaderType type, const std::vector<ShaderStageSource> &stage_sources) {
+
+    bool logging = logger_component.logging_enabled;
+    auto logger = logger_component.get_logger();
+
     if (logging) {
         logger->info("creating new shader program");
     }
 
-    const ShaderCreationInfo &shader_info = it->second;
+    PendingShaderProgram pending_program;
+    pending_program.type = type;
+    pending_program.statistics.type = type;
+    pending_program.statistics.binary_cache_enabled = program_binary_cache_enabled;
+    for (const ShaderStageSource &stage_source : stage_sources) {
+        pending_program.statistics.source_read_time += stage_source.read_time;
+    }
 
-    GLuint shader_program = glCreateProgram();
-    GLuint vertex_shader = attach_shader(shader_program, shader_info.vertex_path, GL_VERTEX_SHADER);
-    GLuint fragment_shader = attach_shader(shader_program, shader_info.fragment_path, GL_FRAGMENT_SHADER);
-    GLuint geometry_shader = 0;
+    // pipelines are assembled from their stages every time, only whole programs go through the binary cache
+    if (separable_programs_enabled and not compute_shader_catalog.count(type)) {
+        pending_program.separable = true;
+        pending_program.statistics.binary_cache_enabled = false;
+        for (const ShaderStageSource &stage_source : stage_sources) {
+            ShaderStageBuildStatistics stage_statistics;
+            GLuint shader = get_compiled_shader_object(stage_source, stage_statistics);
+            GLuint stage_program = get_separable_stage_program(stage_source, shader);
+            pending_program.stage_programs.push_back({stage_source.stage, stage_program});
+            pending_program.shaders.push_back({shader, stage_source.path});
+            pending_program.statistics.stages.push_back(stage_statistics);
+        }
+        pending_program.link_start = std::chrono::steady_clock::now();
+        return pending_program;
+    }
 
-    if (!shader_info.geometry_path.empty()) {
-        geometry_shader = attach_shader(shader_program, shader_info.geometry_path, GL_GEOMETRY_SHADER);
+    pending_program.program = glCreateProgram();
+    if (program_binary_cache_enabled) {
+        std::vector<std::string> sources;
+        for (const ShaderStageSource &stage_source : stage_sources) {
+            sources.push_back(stage_source.source);
+            sources.push_back(stage_source.variant);
+        }
+        pending_program.binary_key = compute_program_binary_key(sources);
+        auto load_start = std::chrono::steady_clock::now();
+        if (load_program_binary(pending_program.program, pending_program.binary_key)) {
+            pending_program.statistics.link_time = elapsed_microseconds(load_start);
+            pending_program.statistics.binary_cache_hit = true;
+            if (logging) {
+                logger->info("Loaded shader program from the program binary cache");
+            }
+            pending_program.loaded_from_binary = true;
+            return pending_program;
+        }
+    }
+
+    for (const ShaderStageSource &stage_source : stage_sources) {
+        ShaderStageBuildStatistics stage_statistics;
+        GLuint shader = get_compiled_shader_object(stage_source, stage_statistics);
+        glAttachShader(pending_program.program, shader);
+        pending_program.shaders.push_back({shader, stage_source.path});
+        pending_program.statistics.stages.push_back(stage_statistics);
+    }
+
+    // some drivers only report a binary length for programs that asked for it
+    if (program_binary_cache_enabled or program_size_estimates_enabled) {
+        glProgramParameteri(pending_program.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     }
 
-    link_program(shader_program);
+    pending_program.link_start = std::chrono::steady_clock::now();
+    glLinkProgram(pending_program.program);
+    return pending_program;
+}
+
+/**
+ * \return false only if the driver says it is still working on the program, querying anything else on it now would
+ * block
+ */
+bool ShaderCache::is_shader_program_complete(const PendingShaderProgram &pending_program) const {
+    if (pending_program.loaded_from_binary or not parallel_shader_compile_supported) {
+        return true;
+    }
 
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
-    if (geometry_shader) {
-        glDeleteShader(geometry_shader);
+    if (pending_program.separable) {
+        for (const auto &[stage, stage_program] : pending_program.stage_programs) {
+            GLint complete = GL_FALSE;
+            glGetProgramiv(stage_program, GL_COMPLETION_STATUS_KHR, &complete);
+            if (not complete) {
+                return false;
+            }
+        }
+        return true;
     }
 
-    ShaderProgramInfo created_shader_info{shader_program};
+    GLint complete = GL_FALSE;
+    glGetProgramiv(pending_program.program, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete;
+}
 
-    created_shaders.insert({type, created_shader_info});
+/**
+ * \brief checks for errors, cleans up the shader objects and makes the program available to the rest of the cache
+ */
+void ShaderCache::finalize_shader_program(PendingShaderProgram &pending_program, bool enforce_budget) {
+    complete_shader_program(pending_program);
+    register_created_shader_program(pending_program.type, pending_program, enforce_budget);
 }
 
 /**
- * \todo make sure that the vertex attribute variable is actually used in the selected shader type
- *
- * \brief configures a VAO so that it knows how to transmit data from a VBO into the shader program
- *
- * \note this assumes that each vertex attribute data array has its own unique vector for storing (usually a
- * std::vector<glm::vec3>>) [or whatever type of vector]
- *
- * \details a good way to think about this is that a shader program has a bunch of incoming conveyor belts, and we need
- * to tell the shader program how big the boxes that are coming in are for each different conveyor belt, then this
- * function is like a conveyor belt configuration, so that we say "BIG_BOXES" and then this function automates setting
- * up the conveyor belt so that the shader program can properly consume those boxes,
+ * \brief checks for errors and cleans up the shader objects, without registering the program
  *
- * With this analogy VAOs are like employees in charge of physical objects, they have different types of objects, say
- * toys, and books which are represented by VBOs they for each type of object, they need to configure how the
- * conveyor belt will operate for each object type (ie, the books can be packed closer than the toys).
- *
- * This function is then like a "training session" for the employee so that they learn how to configure the conveyor
- * belts, for their own custom objects this is done so that no matter what objects need to be packaged up, the
- * corresponding employee will know how to properly do this.
+ * \return true if the program linked
+ */
+bool ShaderCache::complete_shader_program(PendingShaderProgram &pending_program) {
+    if (pending_program.loaded_from_binary) {
+        pending_program.statistics.linked = true;
+        shader_program_build_statistics.push_back(pending_program.statistics);
+        return true;
+    }
+
+    bool linked = true;
+    if (pending_program.separable) {
+        glGenProgramPipelines(1, &pending_program.program);
+        for (const auto &[stage, stage_program] : pending_program.stage_programs) {
+            linked = check_program_link_status(stage_program) and linked;
+            glUseProgramStages(pending_program.program, get_program_stage_bit(stage), stage_program);
+        }
+    } else {
+        linked = check_program_link_status(pending_program.program);
+    }
+    pending_program.statistics.link_time = elapsed_microseconds(pending_program.link_start);
+    pending_program.statistics.linked = linked;
+    shader_program_build_statistics.push_back(pending_program.statistics);
+
+    // the shader objects belong to the cache since other programs may share them
+    if (not linked) {
+        // a failed compile is what usually causes a failed link, so it's only worth asking about then
+        for (const auto &[shader, path] : pending_program.shaders) {
+            check_shader_compile_status(shader, path);
+        }
+    }
+    pending_program.shaders.clear();
+
+    if (linked and program_binary_cache_enabled) {
+        save_program_binary(pending_program.program, pending_program.binary_key);
+    }
+    return linked;
+}
+
+/**
+ * \brief checks the source files of every created program for changes and swaps in rebuilt programs, call it once per
+ * frame, it does nothing unless hot reloading was enabled in the options
  *
- * \param vertex_attribute_object the vao that we need to configure the vertex attributes for
- * \param vertex_buffer_object the buffer contiaining the vertex attribute data
- * \param type the shader we want to do this for
+ * \details the files of all programs are checked at most once per poll interval. A changed program has its sources
+ * read on a background thread, then on a later call it is compiled and linked. Only if that succeeds is the old
+ * program deleted and the new one put in its place, which also rebuilds its location tables, so a shader with a typo
+ * in it just keeps running the last version that worked.
  */
-void ShaderCache::configure_vertex_attributes_for_drawables_vao(
-    GLuint vertex_attribute_object, GLuint vertex_buffer_object, ShaderType type,
-    ShaderVertexAttributeVariable shader_vertex_attribute_variable) {
+void ShaderCache::reload_modified_shader_programs() {
+    if (not hot_reload_enabled) {
+        return;
+    }
 
-    ShaderProgramInfo shader_program_info = get_shader_program(type);
-    //    std::vector<ShaderVertexAttributeVariable> used_vertex_attributes_for_shader =
-    //        get_used_vertex_attribute_variables_for_shader(type);
+    for (auto it = hot_reloads_in_flight.begin(); it != hot_reloads_in_flight.end();) {
+        if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            ++it;
+            continue;
+        }
 
-    glBindVertexArray(vertex_attribute_object); // enable the objects VAO
-    // this has to occur because glEnableVertexArray and glVertexAttribPointer need to know about two things
-    // the output and input we are configuring the communication between.
-    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_object);
+        ShaderType type = it->first;
+        std::vector<ShaderStageSource> stage_sources = it->second.get();
+        it = hot_reloads_in_flight.erase(it);
+        swap_in_reloaded_shader_program(type, stage_sources);
+    }
+    release_unused_retired_separable_stage_programs();
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_hot_reload_poll < hot_reload_poll_interval) {
+        return;
+    }
+    last_hot_reload_poll = now;
+
+    for (std::size_t i = 0; i < created_shaders.size(); i++) {
+        ShaderType type = static_cast<ShaderType>(i);
+        if (not created_shader_alive[i] or hot_reloads_in_flight.count(type)) {
+            continue;
+        }
+
+        bool modified = false;
+        for (WatchedShaderFile &watched_file : created_shaders[i].watched_files) {
+            std::error_code error;
+            auto last_write_time = std::filesystem::last_write_time(watched_file.path, error);
+            // editors often replace the file, so it can be missing for a moment
+            if (not error and last_write_time != watched_file.last_write_time) {
+                watched_file.last_write_time = last_write_time;
+                invalidate_shader_source(watched_file.path.string());
+                modified = true;
+            }
+        }
+
+        if (modified) {
+            if (logger_component.logging_enabled) {
+                logger_component.get_logger()->info("Reloading modified shader {}",
+                                                    shader_standard.shader_type_to_name.at(type));
+            }
+            hot_reloads_in_flight.emplace(
+                type, std::async(std::launch::async, [this, type] { return read_shader_stage_sources(type); }));
+        }
+    }
+}
+
+/**
+ * \brief deletes the stage programs that were replaced by a source change once no pipeline uses them anymore, a
+ * pipeline whose reload failed keeps its old stages alive
+ */
+void ShaderCache::release_unused_retired_separable_stage_programs() {
+    auto is_used = [](const CachedShaderProgram &program, GLuint stage_program) {
+        return std::any_of(program.separable_stages.begin(), program.separable_stages.end(),
+                           [&](const SeparableStage &stage) { return stage.program == stage_program; });
+    };
+
+    for (auto it = retired_separable_stage_programs.begin(); it != retired_separable_stage_programs.end();) {
+        bool used = false;
+        for (std::size_t i = 0; i < created_shaders.size() and not used; i++) {
+            used = created_shader_alive[i] and is_used(created_shaders[i], *it);
+        }
+        for (auto variant_it = shader_variants.begin(); variant_it != shader_variants.end() and not used;
+             ++variant_it) {
+            used = is_used(variant_it->second.program, *it);
+        }
+
+        if (used) {
+            ++it;
+        } else {
+            glDeleteProgram(*it);
+            it = retired_separable_stage_programs.erase(it);
+        }
+    }
+}
+
+void ShaderCache::swap_in_reloaded_shader_program(ShaderType type,
+                                                  const std::vector<ShaderStageSource> &stage_sources) {
+    // unloaded while its sources were being read, it will be built from the new files when it is used again anyway
+    if (not is_shader_program_created(type)) {
+        return;
+    }
+
+    PendingShaderProgram pending_program = submit_shader_program(type, stage_sources);
+    if (not complete_shader_program(pending_program)) {
+        if (logger_component.logging_enabled) {
+            logger_component.get_logger()->error("The reloaded shader {} failed to build, keeping the old program",
+                                                 shader_standard.shader_type_to_name.at(type));
+        }
+        if (pending_program.separable) {
+            glDeleteProgramPipelines(1, &pending_program.program);
+        } else {
+            glDeleteProgram(pending_program.program);
+        }
+        return;
+    }
+
+    // variants are built from the same files, so they are thrown away and the selected one is rebuilt
+    ShaderVariantKey selected_variant_key = get_selected_shader_variant(type);
+    release_shader_variants(type);
+
+    CachedShaderProgram &old_program = created_shaders[static_cast<std::size_t>(type)];
+    bool was_bound = is_cached_shader_program_bound(old_program);
+    bool uniform_shadowing_enabled = old_program.uniform_shadowing_enabled;
+
+    release_cached_shader_program(old_program);
+    register_created_shader_program(type, pending_program);
+
+    if (uniform_shadowing_enabled) {
+        set_uniform_shadowing_enabled(type, true);
+    }
+    if (was_bound) {
+        use_shader_program(type);
+    }
+    if (selected_variant_key != 0) {
+        select_shader_variant(type, selected_variant_key);
+    }
+}
+
+std::vector<WatchedShaderFile> ShaderCache::get_watched_shader_files(ShaderType type) const {
+    std::vector<WatchedShaderFile> watched_files;
+    std::vector<std::string> stage_paths;
+    auto compute_it = compute_shader_catalog.find(type);
+    auto it = shader_standard.shader_catalog.find(type);
+    if (compute_it != compute_shader_catalog.end()) {
+        stage_paths = {compute_it->second};
+    } else if (it != shader_standard.shader_catalog.end()) {
+        stage_paths = {it->second.vertex_path, it->second.fragment_path, it->second.geometry_path};
+    }
+
+    for (const std::string &stage_path : stage_paths) {
+        if (stage_path.empty()) {
+            continue;
+        }
+        std::string resolved_path = resolve_shader_stage_path(stage_path);
+        std::vector<std::string> dependencies = {resolved_path};
+        // included files are watched as well, so editing a shared chunk reloads everything that uses it
+        if (not is_spirv_shader_path(resolved_path)) {
+            dependencies = get_shader_source_dependencies(resolved_path);
+        }
+        for (const std::string &path : dependencies) {
+            std::error_code error;
+            watched_files.push_back({path, std::filesystem::last_write_time(path, error)});
+        }
+    }
+    return watched_files;
+}
+
+/**
+ * \brief makes every following call for the type, use_shader_program, set_uniform and so on, go to the program built
+ * with the defines in variant_key. The variant gets compiled the first time it is selected, pass 0 to go back to the
+ * plain program
+ *
+ * \details the defines are put right after the #version line. Variant programs are kept around up to
+ * max_cached_shader_variants, past that the ones that were selected least recently are deleted and just get rebuilt
+ * if they are needed again, with the program binary cache that is cheap. SPIR-V stages don't get defines, use
+ * specialization constants for those
+ */
+void ShaderCache::select_shader_variant(ShaderType type, ShaderVariantKey variant_key) {
+    std::size_t index = static_cast<std::size_t>(type);
+    if (index >= selected_shader_variant_programs.size()) {
+        selected_shader_variant_programs.resize(index + 1, nullptr);
+        selected_shader_variant_keys.resize(index + 1, 0);
+    }
+
+    if (variant_key == 0) {
+        selected_shader_variant_programs[index] = nullptr;
+        selected_shader_variant_keys[index] = 0;
+        return;
+    }
+
+    ShaderVariant &variant = get_or_create_shader_variant(type, variant_key);
+    shader_variant_lru.splice(shader_variant_lru.begin(), shader_variant_lru, variant.lru_position);
+    selected_shader_variant_programs[index] = &variant.program;
+    selected_shader_variant_keys[index] = variant_key;
+    evict_shader_variants();
+}
+
+ShaderVariantKey ShaderCache::get_selected_shader_variant(ShaderType type) const {
+    std::size_t index = static_cast<std::size_t>(type);
+    return index < selected_shader_variant_keys.size() ? selected_shader_variant_keys[index] : 0;
+}
+
+/**
+ * \brief builds the given variants ahead of time, all of them are submitted before any is waited on so with
+ * KHR_parallel_shader_compile they build at the same time. A key of 0 creates the plain program
+ */
+void ShaderCache::prewarm_shader_variants(const std::vector<std::pair<ShaderType, ShaderVariantKey>> &variants) {
+    std::vector<ShaderType> plain_types;
+    std::vector<std::tuple<ShaderType, ShaderVariantKey, PendingShaderProgram>> pending_variants;
+    for (const auto &[type, variant_key] : variants) {
+        if (variant_key == 0) {
+            plain_types.push_back(type);
+            continue;
+        }
+        if (shader_variants.count(get_shader_variant_id(type, variant_key)) or
+            std::any_of(pending_variants.begin(), pending_variants.end(), [&](const auto &pending_variant) {
+                return std::get<0>(pending_variant) == type and std::get<1>(pending_variant) == variant_key;
+            })) {
+            continue;
+        }
+        check_shader_variant_key(variant_key);
+        pending_variants.emplace_back(type, variant_key,
+                                      submit_shader_program(type, read_shader_stage_sources(type, variant_key)));
+    }
+
+    create_shader_programs(plain_types);
+    for (auto &[type, variant_key, pending_program] : pending_variants) {
+        add_shader_variant(type, variant_key, pending_program);
+    }
+    evict_shader_variants();
+}
+
+std::size_t ShaderCache::get_cached_shader_variant_count() const { return shader_variants.size(); }
+
+std::uint64_t ShaderCache::get_shader_variant_id(ShaderType type, ShaderVariantKey variant_key) {
+    return (static_cast<std::uint64_t>(type) << 32) | variant_key;
+}
+
+void ShaderCache::check_shader_variant_key(ShaderVariantKey variant_key) const {
+    if ((static_cast<std::uint64_t>(variant_key) >> shader_variant_defines.size()) != 0) {
+        throw std::runtime_error("Shader variant key uses a define that was not given in the options");
+    }
+}
+
+ShaderCache::ShaderVariant &ShaderCache::get_or_create_shader_variant(ShaderType type, ShaderVariantKey variant_key) {
+    auto it = shader_variants.find(get_shader_variant_id(type, variant_key));
+    if (it != shader_variants.end()) {
+        return it->second;
+    }
+
+    check_shader_variant_key(variant_key);
+    PendingShaderProgram pending_program = submit_shader_program(type, read_shader_stage_sources(type, variant_key));
+    return add_shader_variant(type, variant_key, pending_program);
+}
+
+ShaderCache::ShaderVariant &ShaderCache::add_shader_variant(ShaderType type, ShaderVariantKey variant_key,
+                                                            PendingShaderProgram &pending_program) {
+    pending_program.statistics.variant_key = variant_key;
+    complete_shader_program(pending_program);
+
+    std::uint64_t id = get_shader_variant_id(type, variant_key);
+    auto existing = shader_variants.find(id);
+    if (existing != shader_variants.end()) {
+        // built twice, the one already in use stays
+        if (pending_program.separable) {
+            glDeleteProgramPipelines(1, &pending_program.program);
+        } else {
+            glDeleteProgram(pending_program.program);
+        }
+        return existing->second;
+    }
+
+    ShaderVariant variant;
+    variant.program = build_cached_shader_program(type, pending_program);
+    // a variant behaves like the plain program it came from
+    if (is_shader_program_created(type) and created_shaders[static_cast<std::size_t>(type)].uniform_shadowing_enabled) {
+        variant.program.uniform_shadowing_enabled = true;
+        variant.program.uniform_shadows.resize(uniform_location_table_size);
+    }
+    shader_variant_lru.push_front(id);
+    variant.lru_position = shader_variant_lru.begin();
+
+    if (logger_component.logging_enabled) {
+        logger_component.get_logger()->info("Built variant {} of shader {}", variant_key,
+                                            shader_standard.shader_type_to_name.at(type));
+    }
+    return shader_variants.emplace(id, std::move(variant)).first->second;
+}
+
+/**
+ * \brief deletes the least recently selected variants until there are no more than max_cached_shader_variants,
+ * variants that are currently selected are skipped
+ */
+void ShaderCache::evict_shader_variants() {
+    auto it = shader_variant_lru.end();
+    while (shader_variants.size() > max_cached_shader_variants and it != shader_variant_lru.begin()) {
+        --it;
+        auto variant_it = shader_variants.find(*it);
+        if (variant_it == shader_variants.end()) {
+            it = shader_variant_lru.erase(it);
+            continue;
+        }
+        std::size_t index = static_cast<std::size_t>(*it >> 32);
+        if (index < selected_shader_variant_programs.size() and
+            selected_shader_variant_programs[index] == &variant_it->second.program) {
+            continue;
+        }
+        release_cached_shader_program(variant_it->second.program);
+        shader_variants.erase(variant_it);
+        it = shader_variant_lru.erase(it);
+    }
+}
+
+/**
+ * \brief deletes every variant of the type and goes back to the plain program
+ */
+void ShaderCache::release_shader_variants(ShaderType type) {
+    select_shader_variant(type, 0);
+    for (auto it = shader_variant_lru.begin(); it != shader_variant_lru.end();) {
+        if (static_cast<ShaderType>(*it >> 32) != type) {
+            ++it;
+            continue;
+        }
+        auto variant_it = shader_variants.find(*it);
+        if (variant_it != shader_variants.end()) {
+            release_cached_shader_program(variant_it->second.program);
+            shader_variants.erase(variant_it);
+        }
+        it = shader_variant_lru.erase(it);
+    }
+}
+
+/**
+ * \brief puts a #define for every bit of the key right after the #version line, #version has to come first in glsl.
+ * A #line directive follows so that compile errors still point at the right line of the file
+ */
+std::string ShaderCache::inject_shader_variant_defines(const std::string &source, ShaderVariantKey variant_key) const {
+    std::string defines;
+    for (std::size_t i = 0; i < shader_variant_defines.size(); i++) {
+        if (variant_key & (ShaderVariantKey(1) << i)) {
+            defines += "#define " + shader_variant_defines[i] + "\n";
+        }
+    }
+
+    std::size_t insert_position = 0;
+    std::size_t lines_before = 0;
+    std::size_t version_position = source.find("#version");
+    if (version_position != std::string::npos) {
+        std::size_t line_end = source.find('\n', version_position);
+        insert_position = line_end == std::string::npos ? source.size() : line_end + 1;
+        lines_before = std::count(source.begin(), source.begin() + insert_position, '\n');
+    }
+
+    std::string injected = source.substr(0, insert_position);
+    if (insert_position == source.size() and (injected.empty() or injected.back() != '\n')) {
+        injected += "\n";
+    }
+    injected += defines;
+    injected += "#line " + std::to_string(lines_before + 1) + "\n";
+    injected += source.substr(insert_position);
+    return injected;
+}
+
+/**
+ * \brief deletes the gl objects owned by the entry, the entry itself is left for the caller to reset
+ */
+void ShaderCache::release_cached_shader_program(CachedShaderProgram &program) {
+    for (GLuint &shared_vao : program.shared_vertex_format_vaos) {
+        if (shared_vao != 0) {
+            glDeleteVertexArrays(1, &shared_vao);
+            shared_vao = 0;
+        }
+    }
+    if (program.pipeline != 0) {
+        if (program.pipeline == currently_bound_pipeline) {
+            currently_bound_pipeline = 0;
+        }
+        // the stage programs are shared with other pipelines, they are deleted along with the cache
+        glDeleteProgramPipelines(1, &program.pipeline);
+        return;
+    }
+    if (program.info.id == currently_bound_program) {
+        currently_bound_program = 0;
+    }
+    glDeleteProgram(program.info.id);
+}
+
+/**
+ * \brief a pipeline's name lives in a different namespace than program names, so info.id of a pipeline can't be
+ * compared with the bound program
+ */
+bool ShaderCache::is_cached_shader_program_bound(const CachedShaderProgram &program) const {
+    if (program.pipeline != 0) {
+        return currently_bound_program == 0 and program.pipeline == currently_bound_pipeline;
+    }
+    return program.info.id == currently_bound_program;
+}
+
+CachedShaderProgram ShaderCache::build_cached_shader_program(ShaderType type,
+                                                             const PendingShaderProgram &pending_program) {
+    GLuint shader_program = pending_program.program;
+    CachedShaderProgram created_shader;
+    created_shader.info = ShaderProgramInfo{shader_program};
+    created_shader.build_id = next_program_build_id++;
+    if (pending_program.separable) {
+        created_shader.pipeline = shader_program;
+        created_shader.uniform_locations.assign(uniform_location_table_size, -1);
+        for (const auto &[stage, stage_program] : pending_program.stage_programs) {
+            SeparableStage separable_stage{stage, stage_program, build_uniform_location_table(stage_program)};
+            for (std::size_t i = 0; i < uniform_location_table_size; i++) {
+                if (created_shader.uniform_locations[i] == -1) {
+                    created_shader.uniform_locations[i] = separable_stage.uniform_locations[i];
+                }
+            }
+            if (stage == GL_VERTEX_SHADER) {
+                created_shader.attribute_locations = build_attribute_location_table(stage_program);
+            }
+            created_shader.separable_stages.push_back(std::move(separable_stage));
+        }
+    } else {
+        created_shader.uniform_locations = build_uniform_location_table(shader_program);
+        created_shader.attribute_locations = build_attribute_location_table(shader_program);
+    }
+    assign_sampler_texture_units(created_shader);
+    if (compute_shader_catalog.count(type)) {
+        glGetProgramiv(shader_program, GL_COMPUTE_WORK_GROUP_SIZE, created_shader.compute_work_group_size.data());
+    }
+
+    for (GLuint program : get_linked_programs(created_shader)) {
+        for (const SharedUniformBlock &block : shared_uniform_blocks) {
+            bind_shared_uniform_block(program, block);
+        }
+        for (const InstanceDataBuffer &instance_buffer : instance_data_buffers) {
+            bind_instance_data_buffer(program, instance_buffer);
+        }
+    }
+
+    if (hot_reload_enabled) {
+        created_shader.watched_files = get_watched_shader_files(type);
+    }
+    return created_shader;
+}
+
+/**
+ * \param enforce_budget whether to unload other programs right away if this one goes over the resident program budget
+ */
+void ShaderCache::register_created_shader_program(ShaderType type, const PendingShaderProgram &pending_program,
+                                                  bool enforce_budget) {
+    CachedShaderProgram created_shader = build_cached_shader_program(type, pending_program);
+
+    // the tables are sized from the catalog, so this only grows for types that were added to it after construction
+    std::size_t index = static_cast<std::size_t>(type);
+    if (index >= created_shaders.size()) {
+        created_shaders.resize(index + 1);
+        created_shader_alive.resize(index + 1, false);
+        resident_shader_program_lru_positions.resize(index + 1);
+        resident_shader_program_sizes.resize(index + 1, 0);
+        selected_shader_variant_programs.resize(index + 1, nullptr);
+        selected_shader_variant_keys.resize(index + 1, 0);
+    }
+    // a hot reload replaces a program that is still registered
+    if (created_shader_alive[index]) {
+        forget_resident_shader_program(type);
+    }
+    created_shaders[index] = std::move(created_shader);
+    created_shader_alive[index] = true;
+
+    // pipelines share their stage programs, unloading one frees next to nothing so it isn't given a size
+    GLint binary_length = 0;
+    if (program_size_estimates_enabled and created_shaders[index].pipeline == 0) {
+        glGetProgramiv(created_shaders[index].info.id, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+    }
+    resident_shader_program_sizes[index] = static_cast<std::size_t>(binary_length);
+    resident_shader_program_bytes += resident_shader_program_sizes[index];
+    resident_shader_program_lru.push_front(type);
+    resident_shader_program_lru_positions[index] = resident_shader_program_lru.begin();
+
+    if (unloaded_shadowed_shader_types.erase(type)) {
+        set_uniform_shadowing_enabled(type, true);
+    }
+    if (enforce_budget) {
+        evict_resident_shader_programs(type);
+    }
+}
+
+/**
+ * \brief deletes the program of the type to free the driver memory it takes, the next time the type is used it gets
+ * built again which is quick when the program binary cache is enabled. Its variants are deleted as well and the plain
+ * program is selected
+ *
+ * \note until then it counts as not ready, so get_shader_program throws, is_ready or any non-const use brings it back
+ * \return false if the type had no program to unload
+ */
+bool ShaderCache::unload_shader_program(ShaderType type) {
+    release_shader_variants(type);
+
+    auto pending_it = pending_shader_programs.find(type);
+    if (pending_it != pending_shader_programs.end()) {
+        // a pending pipeline doesn't exist yet, its stage programs belong to the cache
+        if (not pending_it->second.separable) {
+            glDeleteProgram(pending_it->second.program);
+        }
+        pending_shader_programs.erase(pending_it);
+        deferred_shader_types.insert(type);
+        return true;
+    }
+    if (not is_shader_program_created(type)) {
+        return false;
+    }
+
+    std::size_t index = static_cast<std::size_t>(type);
+    if (active_gpu_timer_query and gpu_timer_queries[*active_gpu_timer_query].type == type) {
+        end_gpu_timer_query();
+    }
+    if (created_shaders[index].uniform_shadowing_enabled) {
+        unloaded_shadowed_shader_types.insert(type);
+    }
+    forget_resident_shader_program(type);
+    release_cached_shader_program(created_shaders[index]);
+    created_shaders[index] = CachedShaderProgram();
+    created_shader_alive[index] = false;
+    deferred_shader_types.insert(type);
+    return true;
+}
+
+std::size_t ShaderCache::get_resident_shader_program_count() const { return resident_shader_program_lru.size(); }
+
+/**
+ * \return the combined GL_PROGRAM_BINARY_LENGTH of the created programs, only tracked while a byte budget is set
+ */
+std::size_t ShaderCache::get_resident_shader_program_bytes() const { return resident_shader_program_bytes; }
+
+void ShaderCache::touch_resident_shader_program(ShaderType type) {
+    if (not is_shader_program_created(type)) {
+        return;
+    }
+    auto position = resident_shader_program_lru_positions[static_cast<std::size_t>(type)];
+    resident_shader_program_lru.splice(resident_shader_program_lru.begin(), resident_shader_program_lru, position);
+}
+
+/**
+ * \brief takes a created program out of the lru and the byte count, the program itself is left alone
+ */
+void ShaderCache::forget_resident_shader_program(ShaderType type) {
+    std::size_t index = static_cast<std::size_t>(type);
+    resident_shader_program_lru.erase(resident_shader_program_lru_positions[index]);
+    resident_shader_program_bytes -= resident_shader_program_sizes[index];
+    resident_shader_program_sizes[index] = 0;
+}
+
+bool ShaderCache::is_over_resident_shader_program_budget() const {
+    bool over_count = max_resident_shader_programs > 0 and
+                      resident_shader_program_lru.size() > max_resident_shader_programs;
+    bool over_bytes = program_size_estimates_enabled and
+                      resident_shader_program_bytes > resident_shader_program_byte_budget;
+    return over_count or over_bytes;
+}
+
+/**
+ * \brief unloads the least recently used programs until the cache is back within its budget, the bound program, ones
+ * with a selected variant and ones with a hot reload on the way are skipped
+ *
+ * \param protected_type usually the program that was just created, which is about to be used
+ */
+void ShaderCache::evict_resident_shader_programs(std::optional<ShaderType> protected_type) {
+    auto it = resident_shader_program_lru.end();
+    while (is_over_resident_shader_program_budget() and it != resident_shader_program_lru.begin()) {
+        --it;
+        ShaderType type = *it;
+        const CachedShaderProgram &program = created_shaders[static_cast<std::size_t>(type)];
+        bool bound = is_cached_shader_program_bound(program);
+        bool variant_selected = get_selected_shader_variant(type) != 0;
+        if (type == protected_type or bound or variant_selected or hot_reloads_in_flight.count(type)) {
+            continue;
+        }
+        // unloading erases the element, so step forward first and come back to whatever is behind it
+        ++it;
+        unload_shader_program(type);
+        if (logger_component.logging_enabled) {
+            logger_component.get_logger()->info("Unloaded shader {} to stay within the shader program budget",
+                                                shader_standard.shader_type_to_name.at(type));
+        }
+    }
+}
+
+/**
+ * \brief the program binary cache is only usable if the driver exposes at least one binary format, some drivers
+ * support the extension but report zero formats
+ */
+bool ShaderCache::initialize_program_binary_cache(const std::string &directory) {
+    if (directory.empty()) {
+        return false;
+    }
+
+    GLint num_binary_formats = 0;
+    if (GLAD_GL_VERSION_4_1 or GLAD_GL_ARB_get_program_binary) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_binary_formats);
+    }
+    if (num_binary_formats == 0) {
+        if (logger_component.logging_enabled) {
+            logger_component.get_logger()->warn(
+                "A program binary cache directory was given but the driver has no program binary formats");
+        }
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        if (logger_component.logging_enabled) {
+            logger_component.get_logger()->error("Could not create the program binary cache directory {}: {}",
+                                                 directory, error.message());
+        }
+        return false;
+    }
+
+    // a binary is only valid for the exact driver that produced it, so this goes into every key
+    auto gl_string = [](GLenum name) {
+        const GLubyte *value = glGetString(name);
+        return value ? std::string(reinterpret_cast<const char *>(value)) : std::string();
+    };
+    program_binary_driver_identifier =
+        gl_string(GL_VENDOR) + "|" + gl_string(GL_RENDERER) + "|" + gl_string(GL_VERSION);
+    program_binary_cache_directory = directory;
+    return true;
+}
+
+/**
+ * \brief 64 bit fnv-1a over the driver identifier and the stage sources, stable between runs unlike std::hash
+ */
+std::string ShaderCache::compute_program_binary_key(const std::vector<std::string> &stage_sources) const {
+    std::uint64_t hash = 14695981039346656037ull;
+    auto hash_bytes = [&hash](const std::string &bytes) {
+        for (unsigned char c : bytes) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        // separate the inputs so that moving text from one stage into the next changes the key
+        hash ^= 0xff;
+        hash *= 1099511628211ull;
+    };
+
+    hash_bytes(program_binary_driver_identifier);
+    for (const std::string &source : stage_sources) {
+        hash_bytes(source);
+    }
+
+    std::ostringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return key.str();
+}
+
+std::filesystem::path ShaderCache::get_program_binary_path(const std::string &binary_key) const {
+    return std::filesystem::path(program_binary_cache_directory) / (binary_key + ".bin");
+}
+
+/**
+ * \brief a cached binary file is the GLenum binary format followed by the blob from glGetProgramBinary
+ *
+ * \return true if the program is linked and ready to use, false means the caller should compile from source, which
+ * happens when there is no binary yet or the driver rejects it (usually after a driver update)
+ */
+bool ShaderCache::load_program_binary(GLuint program, const std::string &binary_key) {
+    std::filesystem::path path = get_program_binary_path(binary_key);
+    std::ifstream binary_file(path, std::ios::binary | std::ios::ate);
+    if (not binary_file) {
+        return false;
+    }
+
+    std::streamsize file_size = binary_file.tellg();
+    GLenum binary_format = 0;
+    if (file_size <= static_cast<std::streamsize>(sizeof(binary_format))) {
+        return false;
+    }
+
+    std::vector<char> binary(static_cast<std::size_t>(file_size) - sizeof(binary_format));
+    binary_file.seekg(0);
+    binary_file.read(reinterpret_cast<char *>(&binary_format), sizeof(binary_format));
+    binary_file.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+    if (not binary_file) {
+        return false;
+    }
+
+    glProgramBinary(program, binary_format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+    GLint success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (not success) {
+        if (logger_component.logging_enabled) {
+            logger_component.get_logger()->info("The driver rejected the cached program binary {}, recompiling",
+                                                path.string());
+        }
+        return false;
+    }
+    return true;
+}
+
+void ShaderCache::save_program_binary(GLuint program, const std::string &binary_key) {
+    GLint binary_length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+    if (binary_length <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(static_cast<std::size_t>(binary_length));
+    GLenum binary_format = 0;
+    glGetProgramBinary(program, binary_length, nullptr, &binary_format, binary.data());
+
+    // write next to the final file and then rename, so that a crash never leaves a truncated binary behind
+    std::filesystem::path path = get_program_binary_path(binary_key);
+    std::filesystem::path temporary_path = path;
+    temporary_path += ".tmp";
+    {
+        std::ofstream binary_file(temporary_path, std::ios::binary | std::ios::trunc);
+        binary_file.write(reinterpret_cast<const char *>(&binary_format), sizeof(binary_format));
+        binary_file.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+        if (not binary_file) {
+            if (logger_component.logging_enabled) {
+                logger_component.get_logger()->warn("Could not write the program binary {}", temporary_path.string());
+            }
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+    if (error and logger_component.logging_enabled) {
+        logger_component.get_logger()->warn("Could not store the program binary {}: {}", path.string(),
+                                            error.message());
+    }
+}
+
+/**
+ * \brief queries the location of every active uniform in the program once, so that setting a uniform later on is just
+ * an index into the returned table
+ *
+ * \return a table indexed by ShaderUniformVariable, uniforms which are not active in the program are set to -1
+ */
+std::vector<GLint> ShaderCache::build_uniform_location_table(GLuint program) const {
+    std::vector<GLint> uniform_locations(uniform_location_table_size, -1);
+
+    GLint num_uniforms = 0;
+    GLint max_name_length = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &num_uniforms);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+
+    std::vector<GLchar> name_buffer(std::max(max_name_length, 1));
+    for (GLint i = 0; i < num_uniforms; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum gl_type = 0;
+        glGetActiveUniform(program, i, static_cast<GLsizei>(name_buffer.size()), &length, &size, &gl_type,
+                           name_buffer.data());
+        std::string name(name_buffer.data(), length);
+
+        // arrays are reported as "name[0]" but the shader standard refers to them by their plain name
+        const std::string array_suffix = "[0]";
+        if (name.size() > array_suffix.size() &&
+            name.compare(name.size() - array_suffix.size(), array_suffix.size(), array_suffix) == 0) {
+            name.erase(name.size() - array_suffix.size());
+        }
+
+        auto it = uniform_name_to_variable.find(name);
+        if (it == uniform_name_to_variable.end()) {
+            bool is_built_in = name.rfind("gl_", 0) == 0;
+            if (not is_built_in and logger_component.logging_enabled) {
+                logger_component.get_logger()->warn("Active uniform '{}' is not part of the shader standard", name);
+            }
+            continue;
+        }
+
+        // uniforms inside of uniform blocks are active but have no location
+        uniform_locations[static_cast<std::size_t>(it->second)] = glGetUniformLocation(program, name.c_str());
+    }
+
+    return uniform_locations;
+}
+
+/**
+ * \return a table indexed by ShaderVertexAttributeVariable, attributes which are not active in the program are set to
+ * -1
+ */
+std::vector<GLint> ShaderCache::build_attribute_location_table(GLuint program) const {
+    std::vector<GLint> attribute_locations(vertex_attribute_variable_names.size(), -1);
+    for (std::size_t i = 0; i < vertex_attribute_variable_names.size(); i++) {
+        if (not vertex_attribute_variable_names[i].empty()) {
+            attribute_locations[i] = glGetAttribLocation(program, vertex_attribute_variable_names[i].c_str());
+        }
+    }
+    return attribute_locations;
+}
+
+/**
+ * \brief configures a VAO so that it knows how to transmit data from a VBO into the shader program
+ *
+ * \note this assumes that each vertex attribute data array has its own unique vector for storing (usually a
+ * std::vector<glm::vec3>>) [or whatever type of vector]
+ * , for a single buffer holding all of the attributes see configure_interleaved_vertex_attributes_for_drawables_vao
+ *
+ * \details a good way to think about this is that a shader program has a bunch of incoming conveyor belts, and we need
+ * to tell the shader program how big the boxes that are coming in are for each different conveyor belt, then this
+ * function is like a conveyor belt configuration, so that we say "BIG_BOXES" and then this function automates setting
+ * up the conveyor belt so that the shader program can properly consume those boxes,
+ *
+ * With this analogy VAOs are like employees in charge of physical objects, they have different types of objects, say
+ * toys, and books which are represented by VBOs they for each type of object, they need to configure how the
+ * conveyor belt will operate for each object type (ie, the books can be packed closer than the toys).
+ *
+ * This function is then like a "training session" for the employee so that they learn how to configure the conveyor
+ * belts, for their own custom objects this is done so that no matter what objects need to be packaged up, the
+ * corresponding employee will know how to properly do this.
+ *
+ * \param vertex_attribute_object the vao that we need to configure the vertex attributes for
+ * \param vertex_buffer_object the buffer contiaining the vertex attribute data
+ * \param type the shader we want to do this for
+ */
+void ShaderCache::configure_vertex_attributes_for_drawables_vao(
+    GLuint vertex_attribute_object, GLuint vertex_buffer_object, ShaderType type,
+    ShaderVertexAttributeVariable shader_vertex_attribute_variable) {
+    configure_vertex_attributes_for_drawables_vao(vertex_attribute_object, type,
+                                                  {{shader_vertex_attribute_variable, vertex_buffer_object}});
+}
+
+/**
+ * \brief configures every attribute of a drawable in one go, the VAO is bound once and GL_ARRAY_BUFFER is only rebound
+ * when the buffer changes from one attribute to the next
+ *
+ * \param vertex_attribute_buffers which buffer holds the data for each attribute, attributes that are not active in the
+ * shader are skipped
+ */
+void ShaderCache::configure_vertex_attributes_for_drawables_vao(
+    GLuint vertex_attribute_object, ShaderType type,
+    const std::vector<VertexAttributeBufferBinding> &vertex_attribute_buffers) {
+
+    const CachedShaderProgram &program = get_cached_shader_program(type);
+    SHADER_CACHE_COUNT(type, vertex_array_configurations);
+
+    glBindVertexArray(vertex_attribute_object); // enable the objects VAO
+
+    // 0 is never a buffer anyone would configure an attribute with, so the first attribute always binds
+    GLuint bound_vertex_buffer_object = 0;
+    for (const VertexAttributeBufferBinding &binding : vertex_attribute_buffers) {
+        // this has to occur because glEnableVertexArray and glVertexAttribPointer need to know about two things
+        // the output and input we are configuring the communication between.
+        if (binding.vertex_buffer_object != bound_vertex_buffer_object) {
+            glBindBuffer(GL_ARRAY_BUFFER, binding.vertex_buffer_object);
+            bound_vertex_buffer_object = binding.vertex_buffer_object;
+        }
+        const GLVertexAttributeConfiguration &config =
+            get_gl_vertex_attribute_configuration_for_vertex_attribute_variable(binding.variable);
+        configure_vertex_attribute(program, binding.variable, config.stride, config.pointer_to_start_of_data);
+    }
+
+    glBindVertexArray(0);
+}
+
+/**
+ * \return the size in bytes of a single component of the given gl data type, 0 if it is not a vertex attribute type
+ */
+std::size_t get_size_of_gl_data_type(GLenum data_type) {
+    switch (data_type) {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+        return 1;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:
+        return 2;
+    case GL_INT:
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:
+    case GL_FIXED:
+        return 4;
+    case GL_DOUBLE:
+        return 8;
+    }
+    return 0;
+}
+
+/**
+ * \brief lays out the attributes a shader uses one after the other inside of a single vertex
+ *
+ * \details attributes keep the order of get_used_vertex_attribute_variables_for_shader, each one starts on a multiple
+ * of its component size and never closer than 4 bytes apart since some drivers are slow with unaligned attributes, the
+ * stride is padded so that the next vertex is aligned the same way
+ */
+InterleavedVertexLayout ShaderCache::compute_interleaved_vertex_layout(ShaderType type) const {
+    InterleavedVertexLayout layout;
+    std::size_t offset = 0;
+    std::size_t largest_alignment = 4;
+
+    for (ShaderVertexAttributeVariable variable : get_used_vertex_attribute_variables_for_shader(type)) {
+        const GLVertexAttributeConfiguration &config =
+            get_gl_vertex_attribute_configuration_for_vertex_attribute_variable(variable);
+        std::size_t component_size = get_size_of_gl_data_type(config.data_type_of_component);
+        std::size_t alignment = std::max<std::size_t>(component_size, 4);
+        largest_alignment = std::max(largest_alignment, alignment);
+
+        offset = (offset + alignment - 1) / alignment * alignment;
+        std::size_t size = component_size * static_cast<std::size_t>(config.components_per_vertex);
+        layout.attributes.push_back({variable, offset, size});
+        offset += size;
+    }
+
+    layout.stride = static_cast<GLsizei>((offset + largest_alignment - 1) / largest_alignment * largest_alignment);
+    return layout;
+}
+
+/**
+ * \brief configures a VAO to read every attribute from a single buffer laid out as described by the layout, use
+ * interleave_vertex_data to build the contents of that buffer
+ */
+void ShaderCache::configure_interleaved_vertex_attributes_for_drawables_vao(GLuint vertex_attribute_object,
+                                                                            GLuint vertex_buffer_object,
+                                                                            ShaderType type,
+                                                                            const InterleavedVertexLayout &layout) {
+    const CachedShaderProgram &program = get_cached_shader_program(type);
+    SHADER_CACHE_COUNT(type, vertex_array_configurations);
+
+    glBindVertexArray(vertex_attribute_object);
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_object);
+
+    for (const InterleavedVertexAttribute &attribute : layout.attributes) {
+        configure_vertex_attribute(program, attribute.variable, layout.stride,
+                                   reinterpret_cast<GLvoid *>(attribute.offset));
+    }
+
+    glBindVertexArray(0);
+}
+
+/**
+ * \brief packs separate attribute arrays into the interleaved format described by the layout
+ *
+ * \param attribute_data one pointer per attribute of the layout in the same order, each pointing to vertex_count
+ * tightly packed elements
+ */
+std::vector<unsigned char> interleave_vertex_data(const InterleavedVertexLayout &layout,
+                                                  const std::vector<const void *> &attribute_data,
+                                                  std::size_t vertex_count) {
+    if (attribute_data.size() != layout.attributes.size()) {
+        throw std::invalid_argument("the number of attribute arrays doesn't match the layout");
+    }
+
+    std::size_t stride = static_cast<std::size_t>(layout.stride);
+    std::vector<unsigned char> interleaved(stride * vertex_count, 0);
+    for (std::size_t a = 0; a < layout.attributes.size(); a++) {
+        const InterleavedVertexAttribute &attribute = layout.attributes[a];
+        const unsigned char *source = static_cast<const unsigned char *>(attribute_data[a]);
+        for (std::size_t v = 0; v < vertex_count; v++) {
+            std::memcpy(interleaved.data() + v * stride + attribute.offset, source + v * attribute.size,
+                        attribute.size);
+        }
+    }
+    return interleaved;
+}
+
+/**
+ * \pre the VAO and the buffer holding the attribute's data are bound
+ */
+void ShaderCache::configure_vertex_attribute(const CachedShaderProgram &program,
+                                             ShaderVertexAttributeVariable shader_vertex_attribute_variable,
+                                             GLsizei stride, const GLvoid *pointer_to_start_of_data) {
+    const GLVertexAttributeConfiguration &config =
+        get_gl_vertex_attribute_configuration_for_vertex_attribute_variable(shader_vertex_attribute_variable);
+    std::string_view svav_name = get_vertex_attribute_variable_name(shader_vertex_attribute_variable);
+
+    std::size_t index = static_cast<std::size_t>(shader_vertex_attribute_variable);
+    GLint vertex_attribute_location =
+        index < program.attribute_locations.size() ? program.attribute_locations[index] : -1;
+    if (vertex_attribute_location == -1) {
+        if (logger_component.logging_enabled) {
+            logger_component.get_logger()->warn("Vertex attribute {} is not used by the shader program, skipping it",
+                                                svav_name);
+        }
+        return;
+    }
+
+    if (logger_component.logging_enabled) {
+        logger_component.get_logger()->info("Binding vertex attribute {}", svav_name);
+    }
+
+    glEnableVertexAttribArray(vertex_attribute_location);
+
+    // When stride is 0, it tells OpenGL that the attributes are tightly packed in the array. That
+    // means the next set of attribute data starts immediately after the current one. In this case, since the
+    // data is tightly packed, OpenGL calculates the stride as 2 * sizeof(GL_FLOAT). This value is equivalent to
+    // the size of the attribute data (in bytes) because the next attribute in the buffer starts right after the
+    // previous one without any additional padding or interleaved data.
+
+    if (config.data_type_of_component != GL_INT && config.data_type_of_component != GL_UNSIGNED_INT) {
+        glVertexAttribPointer(vertex_attribute_location, config.components_per_vertex, config.data_type_of_component,
+                              config.normalize, stride, pointer_to_start_of_data);
+    } else {
+        glVertexAttribIPointer(vertex_attribute_location, config.components_per_vertex, config.data_type_of_component,
+                               stride, pointer_to_start_of_data);
+    }
+}
+
+/**
+ * \brief works out, once per shader, how its attributes map onto vertex buffer binding points
+ *
+ * \details with SEPARATE_BUFFERS every used attribute gets its own binding point, in the order of
+ * get_used_vertex_attribute_variables_for_shader, with INTERLEAVED they all share binding point 0 using the offsets
+ * from compute_interleaved_vertex_layout
+ */
+const VertexFormat &ShaderCache::get_vertex_format(ShaderType type, VertexBufferLayout layout) {
+    CachedShaderProgram &program = get_cached_shader_program(type);
+    VertexFormat &vertex_format = program.vertex_formats[static_cast<std::size_t>(layout)];
+    if (vertex_format.computed) {
+        return vertex_format;
+    }
+
+    InterleavedVertexLayout interleaved_layout = compute_interleaved_vertex_layout(type);
+    if (layout == VertexBufferLayout::INTERLEAVED) {
+        vertex_format.binding_strides.push_back(interleaved_layout.stride);
+    }
+
+    for (std::size_t i = 0; i < interleaved_layout.attributes.size(); i++) {
+        const InterleavedVertexAttribute &attribute = interleaved_layout.attributes[i];
+        const GLVertexAttributeConfiguration &config =
+            get_gl_vertex_attribute_configuration_for_vertex_attribute_variable(attribute.variable);
+
+        std::size_t index = static_cast<std::size_t>(attribute.variable);
+        GLint location = index < program.attribute_locations.size() ? program.attribute_locations[index] : -1;
+
+        VertexFormatAttribute format_attribute;
+        format_attribute.location = location;
+        format_attribute.binding_index = layout == VertexBufferLayout::INTERLEAVED ? 0 : static_cast<GLuint>(i);
+        format_attribute.relative_offset =
+            layout == VertexBufferLayout::INTERLEAVED ? static_cast<GLuint>(attribute.offset) : 0;
+        format_attribute.config = config;
+        vertex_format.attributes.push_back(format_attribute);
+
+        if (layout == VertexBufferLayout::SEPARATE_BUFFERS) {
+            // glBindVertexBuffer takes the real stride, 0 doesn't mean tightly packed there
+            GLsizei stride = config.stride != 0 ? config.stride : static_cast<GLsizei>(attribute.size);
+            vertex_format.binding_strides.push_back(stride);
+        }
+    }
+
+    vertex_format.computed = true;
+    return vertex_format;
+}
+
+/**
+ * \brief specifies the vertex format of the shader on the given VAO with glVertexAttribFormat and
+ * glVertexAttribBinding, after this the VAO only needs buffers attached, see bind_vertex_buffers_for_drawable
+ *
+ * \pre the context supports GL 4.3 or ARB_vertex_attrib_binding
+ */
+void ShaderCache::configure_vertex_format_for_vao(GLuint vertex_attribute_object, ShaderType type,
+                                                  VertexBufferLayout layout) {
+    if (not(GLAD_GL_VERSION_4_3 or GLAD_GL_ARB_vertex_attrib_binding)) {
+        throw std::runtime_error("Vertex attribute binding is not supported by this context");
+    }
+
+    const VertexFormat &vertex_format = get_vertex_format(type, layout);
+    SHADER_CACHE_COUNT(type, vertex_array_configurations);
+
+    glBindVertexArray(vertex_attribute_object);
+    for (const VertexFormatAttribute &attribute : vertex_format.attributes) {
+        if (attribute.location == -1) {
+            continue;
+        }
+
+        GLuint location = static_cast<GLuint>(attribute.location);
+        const GLVertexAttributeConfiguration &config = attribute.config;
+        glEnableVertexAttribArray(location);
+        if (config.data_type_of_component != GL_INT && config.data_type_of_component != GL_UNSIGNED_INT) {
+            glVertexAttribFormat(location, config.components_per_vertex, config.data_type_of_component,
+                                 config.normalize, attribute.relative_offset);
+        } else {
+            glVertexAttribIFormat(location, config.components_per_vertex, config.data_type_of_component,
+                                  attribute.relative_offset);
+        }
+        glVertexAttribBinding(location, attribute.binding_index);
+    }
+}
+
+/**
+ * \brief one VAO per shader and layout that every drawable of that shader can share, since the format never changes
+ * a drawable only has to swap its buffers in
+ */
+GLuint ShaderCache::get_shared_vertex_format_vao(ShaderType type, VertexBufferLayout layout) {
+    GLuint &shared_vao = get_cached_shader_program(type).shared_vertex_format_vaos[static_cast<std::size_t>(layout)];
+    if (shared_vao == 0) {
+        glGenVertexArrays(1, &shared_vao);
+        configure_vertex_format_for_vao(shared_vao, type, layout);
+    }
+    return shared_vao;
+}
+
+/**
+ * \brief binds the shared VAO of the shader and attaches a drawable's buffers to it, ready for drawing
+ *
+ * \param vertex_buffer_objects one buffer per used attribute with SEPARATE_BUFFERS in the order of
+ * get_used_vertex_attribute_variables_for_shader, a single buffer with INTERLEAVED
+ * \param element_buffer_object bound as well when non-zero, since the index buffer is part of the VAO's state
+ */
+void ShaderCache::bind_vertex_buffers_for_drawable(ShaderType type, VertexBufferLayout layout,
+                                                   const std::vector<GLuint> &vertex_buffer_objects,
+                                                   GLuint element_buffer_object) {
+    GLuint shared_vao = get_shared_vertex_format_vao(type, layout);
+    const VertexFormat &vertex_format = get_vertex_format(type, layout);
+
+    if (vertex_buffer_objects.size() != vertex_format.binding_strides.size()) {
+        if (logger_component.logging_enabled) {
+            logger_component.get_logger()->error("Expected {} vertex buffers for the vertex format but got {}",
+                                                 vertex_format.binding_strides.size(), vertex_buffer_objects.size());
+        }
+        return;
+    }
+
+    glBindVertexArray(shared_vao);
+    for (std::size_t binding_index = 0; binding_index < vertex_buffer_objects.size(); binding_index++) {
+        glBindVertexBuffer(static_cast<GLuint>(binding_index), vertex_buffer_objects[binding_index], 0,
+                           vertex_format.binding_strides[binding_index]);
+    }
+    if (element_buffer_object != 0) {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_buffer_object);
+    }
+}
+
+/**
+ * \brief tells if the frame counters count anything
+ *
+ * \details only shader_cache.cpp looks at SHADER_CACHE_INSTRUMENTATION, so defining it has to happen when compiling
+ * that file, the header stays the same either way
+ */
+bool ShaderCache::is_frame_instrumentation_enabled() {
+#ifdef SHADER_CACHE_INSTRUMENTATION
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * \brief starts counting a new frame, call it before the first draw of the frame and end_frame after the last one
+ *
+ * \details the counters are compiled out unless SHADER_CACHE_INSTRUMENTATION is defined, then these do next to nothing
+ * and the statistics stay zero, so the calls can stay in production code
+ */
+void ShaderCache::begin_frame() {
+    current_frame_statistics.total = ShaderCacheFrameCounters();
+    std::fill(current_frame_statistics.per_shader_type.begin(), current_frame_statistics.per_shader_type.end(),
+              ShaderCacheFrameCounters());
+}
+
+void ShaderCache::end_frame() {
+    current_frame_statistics.frame_index++;
+    last_frame_statistics = current_frame_statistics;
+
+    if (gpu_profiling_enabled) {
+        // the running query is split at the frame boundary so that a program which stays bound still gets measured
+        std::optional<ShaderType> profiled_type;
+        if (active_gpu_timer_query) {
+            profiled_type = gpu_timer_queries[*active_gpu_timer_query].type;
+        }
+        end_gpu_timer_query();
+        update_gpu_time_statistics();
+        if (profiled_type) {
+            begin_gpu_timer_query(*profiled_type);
+        }
+    }
+}
+
+/**
+ * \return the counters of the frame that end_frame was last called for
+ */
+const ShaderCacheFrameStatistics &ShaderCache::get_last_frame_statistics() const { return last_frame_statistics; }
+
+/**
+ * \brief ends the running query and starts timing the work done with the newly bound type, if the next query of the
+ * ring hasn't come back from the gpu yet this switch simply isn't measured
+ */
+void ShaderCache::begin_gpu_timer_query(ShaderType type) {
+    if (not gpu_profiling_enabled) {
+        return;
+    }
+    end_gpu_timer_query();
+
+    std::size_t query_index = next_gpu_timer_query;
+    if (gpu_timer_queries[query_index].in_flight and not read_gpu_timer_query(query_index)) {
+        dropped_gpu_timer_queries++;
+        return;
+    }
+
+    GpuTimerQuery &timer_query = gpu_timer_queries[query_index];
+    glBeginQuery(GL_TIME_ELAPSED, timer_query.query);
+    timer_query.type = type;
+    timer_query.in_flight = true;
+    active_gpu_timer_query = query_index;
+    next_gpu_timer_query = (query_index + 1) % gpu_timer_queries.size();
+}
+
+void ShaderCache::end_gpu_timer_query() {
+    if (active_gpu_timer_query) {
+        glEndQuery(GL_TIME_ELAPSED);
+        active_gpu_timer_query.reset();
+    }
+}
+
+/**
+ * \brief adds the result of the query to its type if the gpu has it ready, never waits
+ *
+ * \return true if the result was read, the query can then be used again
+ */
+bool ShaderCache::read_gpu_timer_query(std::size_t query_index) {
+    GpuTimerQuery &timer_query = gpu_timer_queries[query_index];
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(timer_query.query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (not available) {
+        return false;
+    }
+
+    GLuint64 elapsed_nanoseconds = 0;
+    glGetQueryObjectui64v(timer_query.query, GL_QUERY_RESULT, &elapsed_nanoseconds);
+    std::size_t index = static_cast<std::size_t>(timer_query.type);
+    if (index >= gpu_time_this_frame.size()) {
+        gpu_time_this_frame.resize(index + 1, std::chrono::nanoseconds(0));
+    }
+    gpu_time_this_frame[index] += std::chrono::nanoseconds(elapsed_nanoseconds);
+    timer_query.in_flight = false;
+    return true;
+}
+
+/**
+ * \brief reads every result that is ready and folds this frame's times into the rolling averages
+ */
+void ShaderCache::update_gpu_time_statistics() {
+    for (std::size_t i = 0; i < gpu_timer_queries.size(); i++) {
+        if (gpu_timer_queries[i].in_flight and active_gpu_timer_query != i) {
+            read_gpu_timer_query(i);
+        }
+    }
+
+    const double smoothing = 0.1;
+    gpu_time_statistics.resize(std::max(gpu_time_statistics.size(), gpu_time_this_frame.size()));
+    gpu_time_this_frame.resize(gpu_time_statistics.size(), std::chrono::nanoseconds(0));
+    for (std::size_t i = 0; i < gpu_time_statistics.size(); i++) {
+        ShaderGpuTimeStatistics &statistics = gpu_time_statistics[i];
+        statistics.last_frame = gpu_time_this_frame[i];
+        double frame_time = static_cast<double>(gpu_time_this_frame[i].count());
+        double &average = statistics.average_frame_time_nanoseconds;
+        average += smoothing * (frame_time - average);
+        gpu_time_this_frame[i] = std::chrono::nanoseconds(0);
+    }
+}
+
+/**
+ * \brief indexed by ShaderType, updated by end_frame when gpu profiling is enabled
+ */
+const std::vector<ShaderGpuTimeStatistics> &ShaderCache::get_gpu_time_statistics() const { return gpu_time_statistics; }
+
+/**
+ * \return how many program switches weren't measured since every query was still waiting on the gpu, if this keeps
+ * going up make gpu_profiling_query_count bigger
+ */
+std::size_t ShaderCache::get_dropped_gpu_timer_query_count() const { return dropped_gpu_timer_queries; }
+
+/**
+ * \brief logs the rolling gpu time of every type that used any, most expensive first
+ */
+void ShaderCache::log_gpu_time_statistics() const {
+    if (not logger_component.logging_enabled) {
+        return;
+    }
+
+    std::vector<std::size_t> types;
+    for (std::size_t i = 0; i < gpu_time_statistics.size(); i++) {
+        if (gpu_time_statistics[i].average_frame_time_nanoseconds > 0) {
+            types.push_back(i);
+        }
+    }
+    std::sort(types.begin(), types.end(), [this](std::size_t a, std::size_t b) {
+        return gpu_time_statistics[a].average_frame_time_nanoseconds >
+               gpu_time_statistics[b].average_frame_time_nanoseconds;
+    });
+
+    logger_component.get_logger()->info("Gpu time per shader, {} switches not measured:", dropped_gpu_timer_queries);
+    for (std::size_t i : types) {
+        logger_component.get_logger()->info("{}: {:.3f}ms average, {:.3f}ms last frame",
+                                            shader_standard.shader_type_to_name.at(static_cast<ShaderType>(i)),
+                                            gpu_time_statistics[i].average_frame_time_nanoseconds / 1e6,
+                                            gpu_time_statistics[i].last_frame.count() / 1e6);
+    }
+}
+
+ShaderCacheFrameCounters &ShaderCache::get_frame_counters(ShaderType type) const {
+    std::vector<ShaderCacheFrameCounters> &per_shader_type = current_frame_statistics.per_shader_type;
+    std::size_t index = static_cast<std::size_t>(type);
+    if (index >= per_shader_type.size()) {
+        per_shader_type.resize(index + 1);
+    }
+    return per_shader_type[index];
+}
+
+void ShaderCache::count_frame_event(ShaderType type, std::size_t ShaderCacheFrameCounters::*counter) const {
+    current_frame_statistics.total.*counter += 1;
+    get_frame_counters(type).*counter += 1;
+}
+
+void ShaderCache::count_uniform_upload(ShaderType type, UniformValueType value_type) const {
+    std::size_t index = static_cast<std::size_t>(value_type);
+    current_frame_statistics.total.uniform_uploads[index]++;
+    get_frame_counters(type).uniform_uploads[index]++;
+}
+
+/**
+ * \return a view into a table the cache owns, it stays valid for the lifetime of the cache and is null terminated so
+ * data() can be handed straight to gl, the view is empty for uniforms that have no name
+ */
+std::string_view ShaderCache::get_uniform_name(ShaderUniformVariable uniform) const {
+    std::size_t index = static_cast<std::size_t>(uniform);
+    if (index < uniform_names.size() and not uniform_names[index].empty()) {
+        return uniform_names[index];
+    }
+
+    if (logger_component.logging_enabled) {
+        logger_component.get_logger()->warn("Uniform variable enum {} not found in allowed names.",
+                                            static_cast<int>(uniform));
+    }
+    return "";
+}
+
+const GLVertexAttributeConfiguration &
+ShaderCache::get_gl_vertex_attribute_configuration_for_vertex_attribute_variable(
+    ShaderVertexAttributeVariable shader_vertex_attribute_variable) const {
+    try {
+        return shader_standard.shader_vertex_attribute_to_glva_configuration.at(shader_vertex_attribute_variable);
+    } catch (const std::out_of_range &e) {
+
+        if (logger_component.logging_enabled) {
+            logger_component.get_logger()->error(
+                "The specified shader vertex attribute variable doesn't have a gl vertex attribute configuration: {}",
+                e.what());
+        }
+        throw;
+    }
+}
+
+const std::vector<ShaderVertexAttributeVariable> &
+ShaderCache::get_used_vertex_attribute_variables_for_shader(ShaderType type) const {
+    try {
+        return shader_standard.shader_to_used_vertex_attribute_variables.at(type);
+    } catch (const std::out_of_range &e) {
+
+        if (logger_component.logging_enabled) {
+            logger_component.get_logger()->error(
+                "The specified shader type doesn't have have any vertex attribute variables, please add some: {}",
+                e.what());
+        }
+        throw;
+    }
+}
+
+/**
+ * \return a view into a table the cache owns, see get_uniform_name
+ */
+std::string_view
+ShaderCache::get_vertex_attribute_variable_name(ShaderVertexAttributeVariable shader_vertex_attribute_variable) const {
+    std::size_t index = static_cast<std::size_t>(shader_vertex_attribute_variable);
+    if (index < vertex_attribute_variable_names.size() and not vertex_attribute_variable_names[index].empty()) {
+        return vertex_attribute_variable_names[index];
+    }
+
+    if (logger_component.logging_enabled) {
+        logger_component.get_logger()->error(
+            "The specified vertex attribute variable doesn't have a name in the mapping: {}", index);
+    }
+    throw std::out_of_range("vertex attribute variable has no name");
+}
+
+/**
+ * \pre the requested shader program has been created
+ * \return the location that was recorded when the program was created, or -1 if the uniform is not active
+ */
+GLint ShaderCache::get_uniform_location(ShaderType type, ShaderUniformVariable uniform) const {
+    SHADER_CACHE_COUNT(type, uniform_location_lookups);
+    return lookup_uniform_location(get_cached_shader_program(type), uniform);
+}
+
+GLint ShaderCache::lookup_uniform_location(const CachedShaderProgram &program, ShaderUniformVariable uniform) const {
+    std::size_t index = static_cast<std::size_t>(uniform);
+    GLint location = index < program.uniform_locations.size() ? program.uniform_locations[index] : -1;
+    if (location == -1) {
+
+        if (logger_component.logging_enabled) {
+            logger_component.get_logger()->error("Uniform '{}' not found in shader program.",
+                                                 get_uniform_name(uniform));
+        }
+    }
+    return location;
+}
+
+/**
+ * \brief when enabled the cache remembers the last value written to each uniform of the program and drops writes that
+ * would not change anything
+ *
+ * \note only writes that go through the cache are tracked, if the uniforms of the program are changed some other way
+ * call invalidate_uniform_shadows
+ */
+void ShaderCache::set_uniform_shadowing_enabled(ShaderType type, bool enabled) {
+    CachedShaderProgram &program = get_cached_shader_program(type);
+    program.uniform_shadowing_enabled = enabled;
+    program.uniform_shadows.clear();
+    if (enabled) {
+        program.uniform_shadows.resize(uniform_location_table_size);
+    }
+}
+
+bool ShaderCache::is_uniform_shadowing_enabled(ShaderType type) const {
+    return get_cached_shader_program(type).uniform_shadowing_enabled;
+}
+
+void ShaderCache::invalidate_uniform_shadows(ShaderType type) {
+    for (UniformShadow &shadow : get_cached_shader_program(type).uniform_shadows) {
+        shadow.valid = false;
+    }
+}
+
+const UniformShadowStatistics &ShaderCache::get_uniform_shadow_statistics(ShaderType type) const {
+    return get_cached_shader_program(type).uniform_shadow_statistics;
+}
+
+/**
+ * \brief compares the value against the shadow copy of the uniform and stores it if it differs
+ *
+ * \return true if the value is the same as the last one written, meaning the write can be dropped
+ */
+bool ShaderCache::uniform_value_unchanged(CachedShaderProgram &program, ShaderUniformVariable uniform,
+                                          const void *data, std::size_t size) {
+    if (not program.uniform_shadowing_enabled) {
+        return false;
+    }
+
+    UniformShadow &shadow = program.uniform_shadows[static_cast<std::size_t>(uniform)];
+    bool fits_inline = size <= shadow.value.size();
+    unsigned char *stored = fits_inline ? shadow.value.data() : shadow.array_value.data();
+
+    if (shadow.valid and shadow.size == size and std::memcmp(stored, data, size) == 0) {
+        program.uniform_shadow_statistics.hits++;
+        return true;
+    }
+
+    if (fits_inline) {
+        std::memcpy(shadow.value.data(), data, size);
+    } else {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        shadow.array_value.assign(bytes, bytes + size);
+    }
+    shadow.size = size;
+    shadow.valid = true;
+    program.uniform_shadow_statistics.misses++;
+    return false;
+}
+
+/**
+ * \return the size in bytes of a single element of the given type, as laid out by glm
+ */
+std::size_t uniform_value_type_size(UniformValueType value_type) {
+    switch (value_type) {
+    case UniformValueType::INT:
+        return sizeof(GLint);
+    case UniformValueType::FLOAT:
+        return sizeof(GLfloat);
+    case UniformValueType::VEC2:
+        return sizeof(glm::vec2);
+    case UniformValueType::VEC3:
+        return sizeof(glm::vec3);
+    case UniformValueType::VEC4:
+        return sizeof(glm::vec4);
+    case UniformValueType::MAT2:
+        return sizeof(glm::mat2);
+    case UniformValueType::MAT3:
+        return sizeof(glm::mat3);
+    case UniformValueType::MAT4:
+        return sizeof(glm::mat4);
+    case UniformValueType::TEXTURE_HANDLE:
+        return sizeof(GLuint64);
+    }
+    return 0;
+}
+
+/**
+ * \brief does the work shared by every set_uniform overload, looks up the location, drops redundant writes and then
+ * uploads the value either through the bound program or with direct state access
+ *
+ * \details without direct state access the program is bound before anything else, so that setting a uniform leaves
+ * its program bound even when the uniform is inactive or the write turns out to be redundant
+ *
+ * \param data count consecutive elements of the given type
+ */
+void ShaderCache::write_uniform(ShaderType type, ShaderUniformVariable uniform, UniformValueType value_type,
+                                const void *data, GLsizei count) {
+    CachedShaderProgram &program = get_cached_shader_program(type);
+    if (not direct_state_access_enabled) {
+        use_shader_program(type);
+    }
+    GLint location = lookup_uniform_location(program, uniform);
+    SHADER_CACHE_COUNT(type, uniform_location_lookups);
+    if (location == -1) {
+        return;
+    }
+    if (value_type == UniformValueType::INT) {
+        remember_sampler_texture_unit(program, uniform, *static_cast<const GLint *>(data));
+    }
+
+    std::size_t size = uniform_value_type_size(value_type) * static_cast<std::size_t>(count);
+    if (uniform_value_unchanged(program, uniform, data, size)) {
+        SHADER_CACHE_COUNT(type, redundant_uniform_writes);
+        return;
+    }
+
+    upload_cached_program_uniform(program, uniform, 0, value_type, data, count);
+    program.last_applied_material = 0;
+    SHADER_CACHE_COUNT_UNIFORM_UPLOAD(type, value_type);
+}
+
+/**
+ * \brief writes count elements of an array uniform starting at first_element, which lands at the location of element 0
+ * plus first_element since the elements of an array of a basic type get consecutive locations
+ *
+ * \details the shadow of the uniform only knows about whole writes, so it is invalidated here
+ */
+void ShaderCache::write_uniform_array_elements(ShaderType type, ShaderUniformVariable uniform,
+                                               UniformValueType value_type, GLint first_element, const void *data,
+                                               GLsizei count) {
+    CachedShaderProgram &program = get_cached_shader_program(type);
+    if (not direct_state_access_enabled) {
+        use_shader_program(type);
+    }
+    GLint location = lookup_uniform_location(program, uniform);
+    SHADER_CACHE_COUNT(type, uniform_location_lookups);
+    if (location == -1) {
+        return;
+    }
+
+    if (program.uniform_shadowing_enabled) {
+        program.uniform_shadows[static_cast<std::size_t>(uniform)].valid = false;
+    }
+
+    upload_cached_program_uniform(program, uniform, first_element, value_type, data, count);
+    program.last_applied_material = 0;
+    SHADER_CACHE_COUNT_UNIFORM_UPLOAD(type, value_type);
+}
+
+/**
+ * \brief uploads with glProgramUniform*, which works whether or not the program is bound
+ */
+void ShaderCache::upload_program_uniform(GLuint program, GLint location, UniformValueType value_type, const void *data,
+                                         GLsizei count) const {
+    const GLint *ints = static_cast<const GLint *>(data);
+    const GLfloat *floats = static_cast<const GLfloat *>(data);
+
+    switch (value_type) {
+    case UniformValueType::INT:
+        glProgramUniform1iv(program, location, count, ints);
+        break;
+    case UniformValueType::FLOAT:
+        glProgramUniform1fv(program, location, count, floats);
+        break;
+    case UniformValueType::VEC2:
+        glProgramUniform2fv(program, location, count, floats);
+        break;
+    case UniformValueType::VEC3:
+        glProgramUniform3fv(program, location, count, floats);
+        break;
+    case UniformValueType::VEC4:
+        glProgramUniform4fv(program, location, count, floats);
+        break;
+    case UniformValueType::MAT2:
+        glProgramUniformMatrix2fv(program, location, count, GL_FALSE, floats);
+        break;
+    case UniformValueType::MAT3:
+        glProgramUniformMatrix3fv(program, location, count, GL_FALSE, floats);
+        break;
+    case UniformValueType::MAT4:
+        glProgramUniformMatrix4fv(program, location, count, GL_FALSE, floats);
+        break;
+    case UniformValueType::TEXTURE_HANDLE:
+        glProgramUniformHandleui64vARB(program, location, count, static_cast<const GLuint64 *>(data));
+        break;
+    }
+}
+
+/**
+ * \brief uploads a value that passed the shadow check to every place it has to go, for a pipeline that is each stage
+ * that declares the uniform, otherwise the program itself
+ *
+ * \pre without direct state access the program is bound
+ */
+void ShaderCache::upload_cached_program_uniform(CachedShaderProgram &program, ShaderUniformVariable uniform,
+                                                GLint first_element, UniformValueType value_type, const void *data,
+                                                GLsizei count) {
+    std::size_t index = static_cast<std::size_t>(uniform);
+    if (program.pipeline != 0) {
+        for (const SeparableStage &stage : program.separable_stages) {
+            if (stage.uniform_locations[index] != -1) {
+                upload_program_uniform(stage.program, stage.uniform_locations[index] + first_element, value_type,
+                                       data, count);
+            }
+        }
+        return;
+    }
+
+    upload_uniform(program.info.id, program.uniform_locations[index] + first_element, value_type, data, count);
+}
+
+/**
+ * \return the programs that make up the cached program, the stage programs for a pipeline and otherwise just the one
+ */
+std::vector<GLuint> ShaderCache::get_linked_programs(const CachedShaderProgram &program) {
+    if (program.pipeline == 0) {
+        return {program.info.id};
+    }
+    std::vector<GLuint> programs;
+    for (const SeparableStage &stage : program.separable_stages) {
+        programs.push_back(stage.program);
+    }
+    return programs;
+}
+
+/**
+ * \brief the bit glUseProgramStages takes for a shader stage
+ */
+GLbitfield get_program_stage_bit(GLenum stage) {
+    switch (stage) {
+    case GL_VERTEX_SHADER:
+        return GL_VERTEX_SHADER_BIT;
+    case GL_FRAGMENT_SHADER:
+        return GL_FRAGMENT_SHADER_BIT;
+    case GL_GEOMETRY_SHADER:
+        return GL_GEOMETRY_SHADER_BIT;
+    case GL_COMPUTE_SHADER:
+        return GL_COMPUTE_SHADER_BIT;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * \brief links a stage on its own as a separable program, only the first time the stage is needed, after that every
+ * pipeline that uses the same stage file shares it. The link status is checked when the pipeline is completed
+ */
+GLuint ShaderCache::get_separable_stage_program(const ShaderStageSource &stage_source, GLuint shader) {
+    auto key = std::make_tuple(stage_source.stage, stage_source.path, stage_source.variant);
+    auto it = separable_stage_programs.find(key);
+    if (it != separable_stage_programs.end()) {
+        return it->second;
+    }
+
+    GLuint stage_program = glCreateProgram();
+    glProgramParameteri(stage_program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    glAttachShader(stage_program, shader);
+    glLinkProgram(stage_program);
+    separable_stage_programs.emplace(key, stage_program);
+    return stage_program;
+}
+
+/**
+ * \pre if direct state access is disabled the program has to be the bound one
+ */
+void ShaderCache::upload_uniform(GLuint program, GLint location, UniformValueType value_type, const void *data,
+                                 GLsizei count) const {
+    if (direct_state_access_enabled) {
+        upload_program_uniform(program, location, value_type, data, count);
+        return;
+    }
+
+    const GLint *ints = static_cast<const GLint *>(data);
+    const GLfloat *floats = static_cast<const GLfloat *>(data);
+
+    switch (value_type) {
+    case UniformValueType::INT:
+        glUniform1iv(location, count, ints);
+        break;
+    case UniformValueType::FLOAT:
+        glUniform1fv(location, count, floats);
+        break;
+    case UniformValueType::VEC2:
+        glUniform2fv(location, count, floats);
+        break;
+    case UniformValueType::VEC3:
+        glUniform3fv(location, count, floats);
+        break;
+    case UniformValueType::VEC4:
+        glUniform4fv(location, count, floats);
+        break;
+    case UniformValueType::MAT2:
+        glUniformMatrix2fv(location, count, GL_FALSE, floats);
+        break;
+    case UniformValueType::MAT3:
+        glUniformMatrix3fv(location, count, GL_FALSE, floats);
+        break;
+    case UniformValueType::MAT4:
+        glUniformMatrix4fv(location, count, GL_FALSE, floats);
+        break;
+    case UniformValueType::TEXTURE_HANDLE:
+        glUniformHandleui64vARB(location, count, static_cast<const GLuint64 *>(data));
+        break;
+    }
+}
+
+void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, bool value) {
+    set_uniform(type, uniform, static_cast<int>(value));
+}
+
+void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, int value) {
+    write_uniform(type, uniform, UniformValueType::INT, &value, 1);
+}
+
+void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, float value) {
+    write_uniform(type, uniform, UniformValueType::FLOAT, &value, 1);
+}
+
+void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::vec2 &vec) {
+    write_uniform(type, uniform, UniformValueType::VEC2, &vec[0], 1);
+}
+
+void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, float x, float y) {
+    set_uniform(type, uniform, glm::vec2(x, y));
+}
+
+void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::vec3 &vec) {
+    write_uniform(type, uniform, UniformValueType::VEC3, &vec[0], 1);
+}
+
+void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, float x, float y, float z) {
+    set_uniform(type, uniform, glm::vec3(x, y, z));
+}
+
+void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::vec4 &vec) {
+    write_uniform(type, uniform, UniformValueType::VEC4, &vec[0], 1);
+}
+
+void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, const std::vector<glm::vec4> &values) {
+    // Ensure the vector is not empty to avoid invalid calls
+    if (values.empty()) {
+        CachedShaderProgram &program = get_cached_shader_program(type);
+        if (not direct_state_access_enabled) {
+            use_shader_program(type);
+        }
+        // still reports a uniform that isn't in the program, like a write with values would
+        if (lookup_uniform_location(program, uniform) != -1 and logger_component.logging_enabled) {
+            logger_component.get_logger()->warn("Attempting to set an empty vec4 array for uniform '{}'.",
+                                                get_uniform_name(uniform));
+        }
+        return;
+    }
+
+    // Set the uniform array of vec4s
+    write_uniform(type, uniform, UniformValueType::VEC4, glm::value_ptr(values[0]),
+                  static_cast<GLsizei>(values.size()));
+}
+
+void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, float x, float y, float z, float w) {
+    set_uniform(type, uniform, glm::vec4(x, y, z, w));
+}
+
+void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::mat2 &mat) {
+    write_uniform(type, uniform, UniformValueType::MAT2, &mat[0][0], 1);
+}
+
+void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::mat3 &mat) {
+    write_uniform(type, uniform, UniformValueType::MAT3, &mat[0][0], 1);
+}
+
+void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::mat4 &mat) {
+    write_uniform(type, uniform, UniformValueType::MAT4, &mat[0][0], 1);
+}
+
+/**
+ * \brief uploads everything recorded in the batch and clears it, see UniformBatch
+ *
+ * \details the writes are sorted by shader type so each program is bound at most once, with uniform shadowing on the
+ * values that didn't change are still filtered out
+ */
+void ShaderCache::flush_uniform_batch(UniformBatch &batch) {
+    std::vector<UniformBatchEntry> &entries = batch.entries;
+    std::sort(entries.begin(), entries.end(), [](const UniformBatchEntry &a, const UniformBatchEntry &b) {
+        return std::tie(a.type, a.uniform, a.element, a.sequence) < std::tie(b.type, b.uniform, b.element, b.sequence);
+    });
+
+    // whole writes sort before the element writes of their uniform, a whole write replaces every element written
+    // before it so those are dropped, element writes recorded after it still land on top
+    std::size_t kept = 0;
+    std::optional<std::uint32_t> whole_write_sequence;
+    for (std::size_t i = 0; i < entries.size(); i++) {
+        UniformBatchEntry entry = entries[i];
+        bool new_uniform = kept == 0 or entry.type != entries[kept - 1].type or
+                           entry.uniform != entries[kept - 1].uniform;
+        if (entry.element == -1) {
+            whole_write_sequence = entry.sequence;
+        } else if (new_uniform) {
+            whole_write_sequence.reset();
+        } else if (whole_write_sequence and entry.sequence < *whole_write_sequence) {
+            continue;
+        }
+        entries[kept++] = entry;
+    }
+    entries.resize(kept);
+
+    auto same_target = [](const UniformBatchEntry &a, const UniformBatchEntry &b) {
+        return a.type == b.type and a.uniform == b.uniform and a.element == b.element;
+    };
+
+    std::size_t i = 0;
+    while (i < entries.size()) {
+        // only the last write to the same target matters, and after sorting that's the last one of its run
+        while (i + 1 < entries.size() and same_target(entries[i], entries[i + 1])) {
+            i++;
+        }
+        const UniformBatchEntry &entry = entries[i];
+        const unsigned char *value = batch.arena.data() + entry.offset;
+
+        if (entry.element == -1) {
+            write_uniform(entry.type, entry.uniform, entry.value_type, value, entry.count);
+            i++;
+            continue;
+        }
+
+        // gather element writes that continue right where the previous one ended into a single upload
+        std::size_t value_size = uniform_value_type_size(entry.value_type);
+        uniform_batch_scratch.assign(value, value + value_size * entry.count);
+        GLint next_element = entry.element + entry.count;
+        i++;
+        while (i < entries.size()) {
+            std::size_t last = i;
+            while (last + 1 < entries.size() and same_target(entries[last], entries[last + 1])) {
+                last++;
+            }
+            const UniformBatchEntry &next = entries[last];
+            if (next.type != entry.type or next.uniform != entry.uniform or next.value_type != entry.value_type or
+                next.element != next_element) {
+                break;
+            }
+            const unsigned char *next_value = batch.arena.data() + next.offset;
+            uniform_batch_scratch.insert(uniform_batch_scratch.end(), next_value, next_value + value_size * next.count);
+            next_element += next.count;
+            i = last + 1;
+        }
+
+        write_uniform_array_elements(entry.type, entry.uniform, entry.value_type, entry.element,
+                                     uniform_batch_scratch.data(), next_element - entry.element);
+    }
+
+    batch.clear();
+}
+
+/**
+ * \brief uploads what every thread recorded into the recorder since the last flush, has to be called on the thread
+ * that owns the context. To drop the writes that wouldn't change anything enable uniform shadowing for the types
+ */
+void ShaderCache::flush_uniform_recorder(UniformRecorder &recorder) { flush_uniform_batch(recorder.collect()); }
+
+/**
+ * \brief the texture target a sampler of the given glsl type reads from, 0 if the type is not a sampler
+ */
+GLenum get_texture_target_for_sampler_type(GLenum sampler_type) {
+    switch (sampler_type) {
+    case GL_SAMPLER_1D:
+    case GL_SAMPLER_1D_SHADOW:
+    case GL_INT_SAMPLER_1D:
+    case GL_UNSIGNED_INT_SAMPLER_1D:
+        return GL_TEXTURE_1D;
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_2D_SHADOW:
+    case GL_INT_SAMPLER_2D:
+    case GL_UNSIGNED_INT_SAMPLER_2D:
+        return GL_TEXTURE_2D;
+    case GL_SAMPLER_3D:
+    case GL_INT_SAMPLER_3D:
+    case GL_UNSIGNED_INT_SAMPLER_3D:
+        return GL_TEXTURE_3D;
+    case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_CUBE_SHADOW:
+    case GL_INT_SAMPLER_CUBE:
+    case GL_UNSIGNED_INT_SAMPLER_CUBE:
+        return GL_TEXTURE_CUBE_MAP;
+    case GL_SAMPLER_1D_ARRAY:
+    case GL_SAMPLER_1D_ARRAY_SHADOW:
+    case GL_INT_SAMPLER_1D_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY:
+        return GL_TEXTURE_1D_ARRAY;
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_2D_ARRAY_SHADOW:
+    case GL_INT_SAMPLER_2D_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+        return GL_TEXTURE_2D_ARRAY;
+    case GL_SAMPLER_CUBE_MAP_ARRAY:
+    case GL_SAMPLER_CUBE_MAP_ARRAY_SHADOW:
+    case GL_INT_SAMPLER_CUBE_MAP_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_CUBE_MAP_ARRAY:
+        return GL_TEXTURE_CUBE_MAP_ARRAY;
+    case GL_SAMPLER_2D_RECT:
+    case GL_SAMPLER_2D_RECT_SHADOW:
+    case GL_INT_SAMPLER_2D_RECT:
+    case GL_UNSIGNED_INT_SAMPLER_2D_RECT:
+        return GL_TEXTURE_RECTANGLE;
+    case GL_SAMPLER_BUFFER:
+    case GL_INT_SAMPLER_BUFFER:
+    case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+        return GL_TEXTURE_BUFFER;
+    case GL_SAMPLER_2D_MULTISAMPLE:
+    case GL_INT_SAMPLER_2D_MULTISAMPLE:
+    case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE:
+        return GL_TEXTURE_2D_MULTISAMPLE;
+    case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+    case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+        return GL_TEXTURE_2D_MULTISAMPLE_ARRAY;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * \brief gives every sampler uniform of the program its own texture unit, in the order the driver lists them, and sets
+ * the uniforms to those units once. After that binding a texture for a sampler is all a draw has to do
+ *
+ * \details every program numbers its units from 0, so samplers that come first in different programs share units. The
+ * stages of a pipeline each get their own range of units instead
+ */
+void ShaderCache::assign_sampler_texture_units(CachedShaderProgram &program) {
+    program.sampler_texture_units.assign(uniform_location_table_size, -1);
+    program.sampler_texture_targets.assign(uniform_location_table_size, 0);
+
+    GLint max_texture_units = 0;
+    glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &max_texture_units);
+
+    if (program.pipeline == 0) {
+        assign_sampler_texture_units(program.info.id, program.uniform_locations, 0, max_texture_units, program);
+        return;
+    }
+
+    // a stage program is shared by many pipelines so its units can't depend on the other stages it is paired with,
+    // instead each stage gets a fixed part of the units, the fragment stage which samples the most gets half of them
+    for (const SeparableStage &stage : program.separable_stages) {
+        GLint first_unit = 0;
+        GLint last_unit = max_texture_units / 2;
+        if (stage.stage == GL_VERTEX_SHADER) {
+            first_unit = max_texture_units / 2;
+            last_unit = max_texture_units * 3 / 4;
+        } else if (stage.stage != GL_FRAGMENT_SHADER) {
+            first_unit = max_texture_units * 3 / 4;
+            last_unit = max_texture_units;
+        }
+        assign_sampler_texture_units(stage.program, stage.uniform_locations, first_unit, last_unit, program);
+    }
+}
+
+/**
+ * \brief assigns the units in [first_unit, last_unit) to the samplers of one linked program and records them in the
+ * sampler tables of the cached program
+ */
+void ShaderCache::assign_sampler_texture_units(GLuint program_id, const std::vector<GLint> &uniform_locations,
+                                               GLint first_unit, GLint last_unit, CachedShaderProgram &program) {
+    GLint num_uniforms = 0;
+    GLint max_name_length = 0;
+    glGetProgramiv(program_id, GL_ACTIVE_UNIFORMS, &num_uniforms);
+    glGetProgramiv(program_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+
+    bool program_uniforms_supported = GLAD_GL_VERSION_4_1 or GLAD_GL_ARB_separate_shader_objects;
+    bool bound_for_assignment = false;
+
+    GLint next_unit = first_unit;
+    std::vector<GLchar> name_buffer(std::max(max_name_length, 1));
+    for (GLint i = 0; i < num_uniforms; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum gl_type = 0;
+        glGetActiveUniform(program_id, i, static_cast<GLsizei>(name_buffer.size()), &length, &size, &gl_type,
+                           name_buffer.data());
+        GLenum target = get_texture_target_for_sampler_type(gl_type);
+        if (target == 0) {
+            continue;
+        }
+
+        std::string name(name_buffer.data(), length);
+        const std::string array_suffix = "[0]";
+        if (name.size() > array_suffix.size() &&
+            name.compare(name.size() - array_suffix.size(), array_suffix.size(), array_suffix) == 0) {
+            name.erase(name.size() - array_suffix.size());
+        }
+        auto it = uniform_name_to_variable.find(name);
+        if (it == uniform_name_to_variable.end()) {
+            continue;
+        }
+        std::size_t index = static_cast<std::size_t>(it->second);
+        if (uniform_locations[index] == -1) {
+            continue;
+        }
+
+        if (next_unit + size > last_unit) {
+            if (logger_component.logging_enabled) {
+                logger_component.get_logger()->warn("Out of texture units for sampler '{}'", name);
+            }
+            continue;
+        }
+
+        std::vector<GLint> units(size);
+        for (GLint element = 0; element < size; element++) {
+            units[element] = next_unit + element;
+        }
+
+        GLint location = uniform_locations[index];
+        if (program_uniforms_supported) {
+            glProgramUniform1iv(program_id, location, size, units.data());
+        } else {
+            if (not bound_for_assignment) {
+                glUseProgram(program_id);
+                bound_for_assignment = true;
+            }
+            glUniform1iv(location, size, units.data());
+        }
+
+        program.sampler_texture_units[index] = next_unit;
+        program.sampler_texture_targets[index] = target;
+        next_unit += size;
+    }
+
+    if (bound_for_assignment) {
+        glUseProgram(currently_bound_program);
+    }
+}
+
+/**
+ * \brief code that still points a sampler at a unit with set_uniform(type, sampler, int) overrides the unit given at
+ * link time, so that is what bind_texture binds to from then on. For an array of samplers the elements are taken to
+ * use consecutive units starting at the one written
+ */
+void ShaderCache::remember_sampler_texture_unit(CachedShaderProgram &program, ShaderUniformVariable uniform,
+                                                GLint unit) {
+    std::size_t index = static_cast<std::size_t>(uniform);
+    if (index < program.sampler_texture_units.size() and program.sampler_texture_units[index] != -1) {
+        program.sampler_texture_units[index] = unit;
+    }
+}
+
+/**
+ * \return the texture unit of the sampler, the one it was given when the program was created unless a unit was set on
+ * it with set_uniform since, -1 if the program has no such sampler
+ */
+GLint ShaderCache::get_sampler_texture_unit(ShaderType type, ShaderUniformVariable sampler) const {
+    const CachedShaderProgram &program = get_cached_shader_program(type);
+    std::size_t index = static_cast<std::size_t>(sampler);
+    return index < program.sampler_texture_units.size() ? program.sampler_texture_units[index] : -1;
+}
+
+/**
+ * \brief binds the texture to the unit of the sampler, skipped if the texture is already bound there
+ *
+ * \details samplers get their units when the program is created, so there is no need to set them. If a sampler is
+ * set to a unit with set_uniform anyway that unit replaces the assigned one, see get_sampler_texture_unit
+ *
+ * \param element for arrays of samplers, the element to bind the texture for
+ * \note the cache only knows about textures bound through it, call invalidate_bound_textures after binding textures
+ * some other way
+ */
+void ShaderCache::bind_texture(ShaderType type, ShaderUniformVariable sampler, GLuint texture, std::size_t element) {
+    const CachedShaderProgram &program = get_cached_shader_program(type);
+    std::size_t index = static_cast<std::size_t>(sampler);
+    if (index >= program.sampler_texture_units.size() or program.sampler_texture_units[index] == -1) {
+        return;
+    }
+
+    std::size_t unit = static_cast<std::size_t>(program.sampler_texture_units[index]) + element;
+    if (unit >= bound_textures.size()) {
+        bound_textures.resize(unit + 1, 0);
+    }
+    if (bound_textures[unit] == texture) {
+        return;
+    }
+
+    if (GLAD_GL_VERSION_4_5) {
+        glBindTextureUnit(static_cast<GLuint>(unit), texture);
+    } else {
+        glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(unit));
+        glBindTexture(program.sampler_texture_targets[index], texture);
+    }
+    bound_textures[unit] = texture;
+}
+
+void ShaderCache::invalidate_bound_textures() { std::fill(bound_textures.begin(), bound_textures.end(), 0); }
+
+bool ShaderCache::is_bindless_texture_supported() const { return bindless_texture_supported; }
+
+/**
+ * \brief gets the bindless handle of the texture and makes it resident, the handle can then be set on sampler uniforms
+ * with set_uniform_texture_handle or written into a uniform or storage buffer, so drawing with it needs no bind at all
+ *
+ * \details the texture can't be modified while it is resident except for its contents, the handle is cached so this is
+ * cheap to call again
+ */
+GLuint64 ShaderCache::make_texture_resident(GLuint texture) {
+    if (not bindless_texture_supported) {
+        throw std::runtime_error("Bindless textures are not supported by this context");
+    }
+
+    auto it = resident_texture_handles.find(texture);
+    if (it != resident_texture_handles.end()) {
+        return it->second;
+    }
+
+    GLuint64 handle = glGetTextureHandleARB(texture);
+    glMakeTextureHandleResidentARB(handle);
+    resident_texture_handles.emplace(texture, handle);
+    return handle;
+}
+
+void ShaderCache::make_texture_non_resident(GLuint texture) {
+    auto it = resident_texture_handles.find(texture);
+    if (it == resident_texture_handles.end()) {
+        return;
+    }
+    glMakeTextureHandleNonResidentARB(it->second);
+    resident_texture_handles.erase(it);
+}
+
+void ShaderCache::set_uniform_texture_handle(ShaderType type, ShaderUniformVariable sampler, GLuint64 handle) {
+    write_uniform(type, sampler, UniformValueType::TEXTURE_HANDLE, &handle, 1);
+}
+
+void ShaderCache::set_uniform_texture_handles(ShaderType type, ShaderUniformVariable sampler,
+                                              const std::vector<GLuint64> &handles) {
+    if (handles.empty()) {
+        return;
+    }
+    write_uniform(type, sampler, UniformValueType::TEXTURE_HANDLE, handles.data(),
+                  static_cast<GLsizei>(handles.size()));
+}
+
+/**
+ * \brief binds the program of the material and uploads its values, only the dirty ones if the program still holds what
+ * this material put there last time
+ *
+ * \details the uploads go straight to the locations stored in the material, so the shadows of those uniforms are
+ * invalidated rather than compared
+ */
+void ShaderCache::apply_material_instance(MaterialInstance &material) {
+    CachedShaderProgram &program = get_cached_shader_program(material.type);
+
+    bool upload_everything = program.last_applied_material != material.id;
+    if (program.build_id != material.program_build_id) {
+        // the program was rebuilt so the locations may have moved
+        for (MaterialInstance::Entry &entry : material.entries) {
+            entry.location = lookup_uniform_location(program, entry.uniform);
+            SHADER_CACHE_COUNT(material.type, uniform_location_lookups);
+        }
+        material.program_build_id = program.build_id;
+        upload_everything = true;
+    }
+
+    use_shader_program(material.type);
+    for (MaterialInstance::Entry &entry : material.entries) {
+        if (not upload_everything and not entry.dirty) {
+            continue;
+        }
+        entry.dirty = false;
+        if (entry.location == -1) {
+            continue;
+        }
+        const unsigned char *value = material.values.data() + entry.offset;
+        if (entry.value_type == UniformValueType::INT) {
+            remember_sampler_texture_unit(program, entry.uniform, *reinterpret_cast<const GLint *>(value));
+        }
+        if (program.pipeline != 0) {
+            upload_cached_program_uniform(program, entry.uniform, 0, entry.value_type, value, entry.count);
+        } else {
+            upload_uniform(program.info.id, entry.location, entry.value_type, value, entry.count);
+        }
+        SHADER_CACHE_COUNT_UNIFORM_UPLOAD(material.type, entry.value_type);
+        if (program.uniform_shadowing_enabled) {
+            program.uniform_shadows[static_cast<std::size_t>(entry.uniform)].valid = false;
+        }
+    }
+    program.last_applied_material = material.id;
+}
+
+/**
+ * \brief creates a uniform buffer for a uniform block that many programs declare, like the camera matrices, so that it
+ * can be written once per frame instead of once per program
+ *
+ * \details every program that declares a block called block_name, now or when it is created later on, gets that block
+ * bound to binding_point. The buffer is a ring of ring_length copies of the block, each update writes into the next
+ * copy so the cpu never writes into memory the gpu may still be reading from. When the context supports buffer storage
+ * the ring is persistently mapped and an update is a single memcpy.
+ *
+ * \param size the size in bytes of the block, the data you write has to match the std140 layout of the block
+ * \return the handle that is passed to update_shared_uniform_block
+ */
+SharedUniformBlockHandle ShaderCache::create_shared_uniform_block(const std::string &block_name, GLuint binding_point,
+                                                                  std::size_t size, std::size_t ring_length) {
+    GLint offset_alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offset_alignment);
+    std::size_t alignment = static_cast<std::size_t>(std::max(offset_alignment, 1));
+
+    SharedUniformBlock block;
+    block.block_name = block_name;
+    block.binding_point = binding_point;
+    block.size = size;
+    block.aligned_size = (size + alignment - 1) / alignment * alignment;
+    block.ring_length = std::max<std::size_t>(ring_length, 1);
+    block.slot_fences.resize(block.ring_length, nullptr);
+
+    GLsizeiptr buffer_size = static_cast<GLsizeiptr>(block.aligned_size * block.ring_length);
+    glGenBuffers(1, &block.buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, block.buffer);
+
+    if (GLAD_GL_VERSION_4_4 or GLAD_GL_ARB_buffer_storage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        // dynamic storage so that update_shared_uniform_block can still fall back to glBufferSubData
+        glBufferStorage(GL_UNIFORM_BUFFER, buffer_size, nullptr, flags | GL_DYNAMIC_STORAGE_BIT);
+        block.mapped = static_cast<unsigned char *>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, buffer_size, flags));
+    } else {
+        glBufferData(GL_UNIFORM_BUFFER, buffer_size, nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    shared_uniform_blocks.push_back(std::move(block));
+
+    for (std::size_t i = 0; i < created_shaders.size(); i++) {
+        if (not created_shader_alive[i]) {
+            continue;
+        }
+        for (GLuint program : get_linked_programs(created_shaders[i])) {
+            bind_shared_uniform_block(program, shared_uniform_blocks.back());
+        }
+    }
+    for (const auto &[id, variant] : shader_variants) {
+        for (GLuint program : get_linked_programs(variant.program)) {
+            bind_shared_uniform_block(program, shared_uniform_blocks.back());
+        }
+    }
 
-    GLVertexAttributeConfiguration config =
-        get_gl_vertex_attribute_configuration_for_vertex_attribute_variable(shader_vertex_attribute_variable);
-    std::string svav_name = get_vertex_attribute_variable_name(shader_vertex_attribute_variable);
+    return shared_uniform_blocks.size() - 1;
+}
 
-    if (logger_component.logging_enabled) {
-        logger_component.get_logger()->info("Binding vertex attribute {}", svav_name);
+/**
+ * \brief writes a new copy of the block and binds it, call this once per frame before drawing with it
+ *
+ * \param size at most the size the block was created with
+ */
+void ShaderCache::update_shared_uniform_block(SharedUniformBlockHandle handle, const void *data, std::size_t size) {
+    SharedUniformBlock &block = shared_uniform_blocks.at(handle);
+    if (size > block.size) {
+        if (logger_component.logging_enabled) {
+            logger_component.get_logger()->error("Tried to write {} bytes to the shared uniform block {} of size {}",
+                                                 size, block.block_name, block.size);
+        }
+        return;
     }
 
-    GLuint vertex_attribute_location = glGetAttribLocation(shader_program_info.id, svav_name.c_str());
-    glEnableVertexAttribArray(vertex_attribute_location);
-
-    // When stride is 0, it tells OpenGL that the attributes are tightly packed in the array. That
-    // means the next set of attribute data starts immediately after the current one. In this case, since the
-    // data is tightly packed, OpenGL calculates the stride as 2 * sizeof(GL_FLOAT). This value is equivalent to
-    // the size of the attribute data (in bytes) because the next attribute in the buffer starts right after the
-    // previous one without any additional padding or interleaved data.
+    // every draw that reads the current copy has been issued by now, so fence it before moving on
+    if (block.slot_fences[block.current_slot]) {
+        glDeleteSync(block.slot_fences[block.current_slot]);
+    }
+    block.slot_fences[block.current_slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    block.current_slot = (block.current_slot + 1) % block.ring_length;
+
+    // with a ring that is a few frames long this almost never has to wait
+    bool slot_free = true;
+    if (GLsync fence = block.slot_fences[block.current_slot]) {
+        const GLuint64 one_second = 1000000000;
+        GLenum wait_result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, one_second);
+        while (wait_result == GL_TIMEOUT_EXPIRED) {
+            wait_result = glClientWaitSync(fence, 0, one_second);
+        }
+        if (wait_result == GL_WAIT_FAILED) {
+            slot_free = false;
+            if (logger_component.logging_enabled) {
+                logger_component.get_logger()->error(
+                    "Waiting on the shared uniform block {} failed, writing it through glBufferSubData",
+                    block.block_name);
+            }
+        }
+        glDeleteSync(fence);
+        block.slot_fences[block.current_slot] = nullptr;
+    }
 
-    if (config.data_type_of_component != GL_INT && config.data_type_of_component != GL_UNSIGNED_INT) {
-        glVertexAttribPointer(vertex_attribute_location, config.components_per_vertex, config.data_type_of_component,
-                              config.normalize, config.stride, config.pointer_to_start_of_data);
+    std::size_t offset = block.current_slot * block.aligned_size;
+    // glBufferSubData is ordered with the draws that read the slot, so it is safe when the wait couldn't tell
+    if (block.mapped and slot_free) {
+        std::memcpy(block.mapped + offset, data, size);
     } else {
-        glVertexAttribIPointer(vertex_attribute_location, config.components_per_vertex, config.data_type_of_component,
-                               config.stride, config.pointer_to_start_of_data);
+        glBindBuffer(GL_UNIFORM_BUFFER, block.buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
     }
 
-    glBindVertexArray(0);
+    glBindBufferRange(GL_UNIFORM_BUFFER, block.binding_point, block.buffer, static_cast<GLintptr>(offset),
+                      static_cast<GLsizeiptr>(block.size));
 }
 
-std::string ShaderCache::get_uniform_name(ShaderUniformVariable uniform) const {
-    auto it = shader_standard.shader_uniform_variable_to_name.find(uniform);
-    if (it != shader_standard.shader_uniform_variable_to_name.end()) {
-        return it->second;
+/**
+ * \brief points the program's copy of the block at the block's binding point, does nothing if the program doesn't
+ * declare the block
+ */
+void ShaderCache::bind_shared_uniform_block(GLuint program, const SharedUniformBlock &block) const {
+    GLuint block_index = glGetUniformBlockIndex(program, block.block_name.c_str());
+    if (block_index == GL_INVALID_INDEX) {
+        return;
     }
 
-    if (logger_component.logging_enabled) {
-        logger_component.get_logger()->warn("Uniform variable enum {} not found in allowed names.",
-                                            static_cast<int>(uniform));
+    GLint block_data_size = 0;
+    glGetActiveUniformBlockiv(program, block_index, GL_UNIFORM_BLOCK_DATA_SIZE, &block_data_size);
+    if (static_cast<std::size_t>(block_data_size) > block.size and logger_component.logging_enabled) {
+        logger_component.get_logger()->warn(
+            "The uniform block {} is {} bytes in program {} but the shared block was created with {} bytes",
+            block.block_name, block_data_size, program, block.size);
     }
-    return "";
+
+    glUniformBlockBinding(program, block_index, block.binding_point);
 }
 
-GLVertexAttributeConfiguration ShaderCache::get_gl_vertex_attribute_configuration_for_vertex_attribute_variable(
-    ShaderVertexAttributeVariable shader_vertex_attribute_variable) const {
-    try {
-        return shader_standard.shader_vertex_attribute_to_glva_configuration.at(shader_vertex_attribute_variable);
-    } catch (const std::out_of_range &e) {
+/**
+ * \brief creates a buffer of per instance data, like model matrices, that every program declaring a buffer block
+ * called block_name reads from, so that many objects can be drawn with one instanced draw
+ *
+ * \details each object gets a slot with allocate_instance_slot which it keeps until it frees it. Writes only go to a
+ * copy on the cpu and flush_instance_data_buffer uploads everything written since the last flush with one call, call
+ * it once per frame before drawing. The shader indexes the array with gl_InstanceID. Without shader storage buffers
+ * the block has to be a uniform block instead, which limits how many instances fit to GL_MAX_UNIFORM_BLOCK_SIZE, which
+ * can be as small as 16KiB, allocating past that throws
+ *
+ * \param instance_size the size of one element of the array, including any padding the layout adds. That is std430
+ * for a storage block, for a uniform block it is std140 where elements are padded to a multiple of 16 bytes, a size
+ * that isn't is rounded up with a warning
+ * \param capacity how many slots to make room for up front, the buffer grows if more are allocated. For a uniform
+ * block it is clamped to what fits
+ * \return the handle passed to the other instance data functions
+ */
+InstanceDataBufferHandle ShaderCache::create_instance_data_buffer(const std::string &block_name,
+                                                                  GLuint binding_point, std::size_t instance_size,
+                                                                  std::size_t capacity) {
+    InstanceDataBuffer instance_buffer;
+    instance_buffer.block_name = block_name;
+    instance_buffer.binding_point = binding_point;
+    instance_buffer.instance_size = instance_size;
+    instance_buffer.capacity = std::max<std::size_t>(capacity, 1);
+    // finding the storage block in a program needs glGetProgramResourceIndex as well
+    bool storage_blocks_supported =
+        GLAD_GL_VERSION_4_3 or (GLAD_GL_ARB_shader_storage_buffer_object and GLAD_GL_ARB_program_interface_query);
+    instance_buffer.target = storage_blocks_supported ? GL_SHADER_STORAGE_BUFFER : GL_UNIFORM_BUFFER;
+
+    if (instance_buffer.target == GL_UNIFORM_BUFFER) {
+        // std140 pads every array element to a multiple of 16 bytes
+        std::size_t std140_instance_size = (std::max<std::size_t>(instance_size, 1) + 15) / 16 * 16;
+        if (std140_instance_size != instance_size) {
+            if (logger_component.logging_enabled) {
+                logger_component.get_logger()->warn(
+                    "Instances of {} are {} bytes, a uniform block array element is padded to {} so that is used",
+                    block_name, instance_size, std140_instance_size);
+            }
+            instance_buffer.instance_size = std140_instance_size;
+        }
 
-        if (logger_component.logging_enabled) {
-            logger_component.get_logger()->error(
-                "The specified shader vertex attribute variable doesn't have a gl vertex attribute configuration: {}",
-                e.what());
+        GLint max_uniform_block_size = 0;
+        glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &max_uniform_block_size);
+        std::size_t block_size = static_cast<std::size_t>(max_uniform_block_size);
+        instance_buffer.max_capacity = block_size / instance_buffer.instance_size;
+        if (instance_buffer.max_capacity == 0) {
+            throw std::runtime_error("One instance of " + block_name + " doesn't fit in a uniform block");
+        }
+        if (instance_buffer.capacity > instance_buffer.max_capacity) {
+            if (logger_component.logging_enabled) {
+                logger_component.get_logger()->warn(
+                    "Only {} instances of {} fit in a uniform block, the capacity is clamped to that",
+                    instance_buffer.max_capacity, block_name);
+            }
+            instance_buffer.capacity = instance_buffer.max_capacity;
         }
-        throw;
     }
-}
+    allocate_instance_data_storage(instance_buffer);
 
-std::vector<ShaderVertexAttributeVariable>
-ShaderCache::get_used_vertex_attribute_variables_for_shader(ShaderType type) const {
-    try {
-        return shader_standard.shader_to_used_vertex_attribute_variables.at(type);
-    } catch (const std::out_of_range &e) {
+    instance_data_buffers.push_back(std::move(instance_buffer));
 
-        if (logger_component.logging_enabled) {
-            logger_component.get_logger()->error(
-                "The specified shader type doesn't have have any vertex attribute variables, please add some: {}",
-                e.what());
+    for (std::size_t i = 0; i < created_shaders.size(); i++) {
+        if (not created_shader_alive[i]) {
+            continue;
+        }
+        for (GLuint program : get_linked_programs(created_shaders[i])) {
+            bind_instance_data_buffer(program, instance_data_buffers.back());
+        }
+    }
+    for (const auto &[id, variant] : shader_variants) {
+        for (GLuint program : get_linked_programs(variant.program)) {
+            bind_instance_data_buffer(program, instance_data_buffers.back());
         }
-        throw;
     }
+
+    return instance_data_buffers.size() - 1;
 }
 
-std::string
-ShaderCache::get_vertex_attribute_variable_name(ShaderVertexAttributeVariable shader_vertex_attribute_variable) const {
-    try {
-        // Use `at` to access the name directly
-        return shader_standard.shader_vertex_attribute_variable_to_name.at(shader_vertex_attribute_variable);
-    } catch (const std::out_of_range &e) {
-        if (logger_component.logging_enabled) {
-            logger_component.get_logger()->error(
-                "The specified vertex attribute variable doesn't have a name in the mapping: {}", e.what());
-        }
-        // Rethrow the exception to continue propagating it upwards
-        throw;
+/**
+ * \brief sizes the cpu copy and the buffer to the capacity, everything in use is marked dirty so the new buffer gets
+ * filled on the next flush
+ */
+void ShaderCache::allocate_instance_data_storage(InstanceDataBuffer &instance_buffer) {
+    instance_buffer.data.resize(instance_buffer.capacity * instance_buffer.instance_size, 0);
+    instance_buffer.slot_used.resize(instance_buffer.capacity, false);
+    instance_buffer.dirty_begin = 0;
+    instance_buffer.dirty_end = instance_buffer.slot_count;
+
+    if (instance_buffer.buffer != 0) {
+        glDeleteBuffers(1, &instance_buffer.buffer);
     }
+    glGenBuffers(1, &instance_buffer.buffer);
+    glBindBuffer(instance_buffer.target, instance_buffer.buffer);
+    glBufferData(instance_buffer.target, static_cast<GLsizeiptr>(instance_buffer.data.size()), nullptr,
+                 GL_DYNAMIC_DRAW);
+    glBindBuffer(instance_buffer.target, 0);
 }
 
-GLint ShaderCache::get_uniform_location(ShaderType type, ShaderUniformVariable uniform) const {
-    ShaderProgramInfo shader_info = get_shader_program(type);
-    GLint location = glGetUniformLocation(shader_info.id, get_uniform_name(uniform).c_str());
-    if (location == -1) {
+/**
+ * \return a slot that stays the same until it is freed, freed slots get handed out again before new ones
+ */
+std::size_t ShaderCache::allocate_instance_slot(InstanceDataBufferHandle handle) {
+    InstanceDataBuffer &instance_buffer = instance_data_buffers.at(handle);
 
-        if (logger_component.logging_enabled) {
-            logger_component.get_logger()->error("Uniform '{}' not found in shader program.",
-                                                 get_uniform_name(uniform));
+    std::size_t slot;
+    if (not instance_buffer.free_slots.empty()) {
+        slot = instance_buffer.free_slots.back();
+        instance_buffer.free_slots.pop_back();
+    } else {
+        if (instance_buffer.slot_count == instance_buffer.capacity) {
+            if (instance_buffer.capacity == instance_buffer.max_capacity) {
+                throw std::runtime_error("The uniform block " + instance_buffer.block_name +
+                                         " can't hold any more instances");
+            }
+            instance_buffer.capacity = std::min(instance_buffer.capacity * 2, instance_buffer.max_capacity);
+            allocate_instance_data_storage(instance_buffer);
         }
+        slot = instance_buffer.slot_count++;
     }
-    return location;
+
+    instance_buffer.slot_used[slot] = true;
+    return slot;
 }
 
-void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, bool value) {
-    use_shader_program(type);
-    GLint location = get_uniform_location(type, uniform);
-    if (location != -1) {
-        glUniform1i(location, static_cast<int>(value));
+/**
+ * \brief gives the slot back, it is zeroed so that an instance drawn from it collapses to nothing until it is reused
+ */
+void ShaderCache::free_instance_slot(InstanceDataBufferHandle handle, std::size_t slot) {
+    InstanceDataBuffer &instance_buffer = instance_data_buffers.at(handle);
+    if (slot >= instance_buffer.slot_count or not instance_buffer.slot_used[slot]) {
+        return;
     }
+
+    instance_buffer.slot_used[slot] = false;
+    instance_buffer.free_slots.push_back(slot);
+    std::vector<unsigned char> zeros(instance_buffer.instance_size, 0);
+    update_instance_data(handle, slot, zeros.data(), zeros.size());
 }
 
-void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, int value) {
-    use_shader_program(type);
-    GLint location = get_uniform_location(type, uniform);
-    if (location != -1) {
-        glUniform1i(location, value);
+/**
+ * \param size at most the instance size the buffer was created with
+ */
+void ShaderCache::update_instance_data(InstanceDataBufferHandle handle, std::size_t slot, const void *data,
+                                       std::size_t size) {
+    InstanceDataBuffer &instance_buffer = instance_data_buffers.at(handle);
+    if (slot >= instance_buffer.slot_count or size > instance_buffer.instance_size) {
+        if (logger_component.logging_enabled) {
+            logger_component.get_logger()->error("Tried to write {} bytes to slot {} of the instance data {}", size,
+                                                 slot, instance_buffer.block_name);
+        }
+        return;
     }
-}
 
-void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, float value) {
-    use_shader_program(type);
-    GLint location = get_uniform_location(type, uniform);
-    if (location != -1) {
-        glUniform1f(location, value);
+    std::memcpy(instance_buffer.data.data() + slot * instance_buffer.instance_size, data, size);
+    if (instance_buffer.dirty_begin == instance_buffer.dirty_end) {
+        instance_buffer.dirty_begin = slot;
+        instance_buffer.dirty_end = slot + 1;
+    } else {
+        instance_buffer.dirty_begin = std::min(instance_buffer.dirty_begin, slot);
+        instance_buffer.dirty_end = std::max(instance_buffer.dirty_end, slot + 1);
     }
 }
 
-void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::vec2 &vec) {
-    use_shader_program(type);
-    GLint location = get_uniform_location(type, uniform);
-    if (location != -1) {
-        glUniform2fv(location, 1, &vec[0]);
+/**
+ * \brief uploads the range of slots written since the last flush with one glBufferSubData and binds the buffer
+ *
+ * \details one range covering everything that changed is cheaper than an upload per slot even if some clean slots in
+ * the middle get sent again, the driver cost is per call far more than per byte
+ */
+void ShaderCache::flush_instance_data_buffer(InstanceDataBufferHandle handle) {
+    InstanceDataBuffer &instance_buffer = instance_data_buffers.at(handle);
+
+    glBindBuffer(instance_buffer.target, instance_buffer.buffer);
+    if (instance_buffer.dirty_begin != instance_buffer.dirty_end) {
+        std::size_t offset = instance_buffer.dirty_begin * instance_buffer.instance_size;
+        std::size_t size = (instance_buffer.dirty_end - instance_buffer.dirty_begin) * instance_buffer.instance_size;
+        glBufferSubData(instance_buffer.target, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size),
+                        instance_buffer.data.data() + offset);
+        instance_buffer.dirty_begin = instance_buffer.dirty_end = 0;
     }
+    glBindBuffer(instance_buffer.target, 0);
+
+    glBindBufferBase(instance_buffer.target, instance_buffer.binding_point, instance_buffer.buffer);
 }
 
-void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, float x, float y) {
-    use_shader_program(type);
-    GLint location = get_uniform_location(type, uniform);
-    if (location != -1) {
-        glUniform2f(location, x, y);
-    }
+/**
+ * \return the instance count to pass to the instanced draw, this includes slots that are free at the moment
+ */
+std::size_t ShaderCache::get_instance_count(InstanceDataBufferHandle handle) const {
+    return instance_data_buffers.at(handle).slot_count;
 }
 
-void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::vec3 &vec) {
-    use_shader_program(type);
-    GLint location = get_uniform_location(type, uniform);
-    if (location != -1) {
-        glUniform3fv(location, 1, &vec[0]);
+/**
+ * \brief points the program's block at the binding point of the instance data, does nothing if the program doesn't
+ * declare the block
+ */
+void ShaderCache::bind_instance_data_buffer(GLuint program, const InstanceDataBuffer &instance_buffer) const {
+    if (instance_buffer.target == GL_UNIFORM_BUFFER) {
+        GLuint block_index = glGetUniformBlockIndex(program, instance_buffer.block_name.c_str());
+        if (block_index != GL_INVALID_INDEX) {
+            glUniformBlockBinding(program, block_index, instance_buffer.binding_point);
+        }
+        return;
     }
-}
 
-void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, float x, float y, float z) {
-    use_shader_program(type);
-    GLint location = get_uniform_location(type, uniform);
-    if (location != -1) {
-        glUniform3f(location, x, y, z);
+    GLuint block_index =
+        glGetProgramResourceIndex(program, GL_SHADER_STORAGE_BLOCK, instance_buffer.block_name.c_str());
+    if (block_index != GL_INVALID_INDEX) {
+        glShaderStorageBlockBinding(program, block_index, instance_buffer.binding_point);
     }
 }
 
-void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::vec4 &vec) {
-    use_shader_program(type);
-    GLint location = get_uniform_location(type, uniform);
-    if (location != -1) {
-        glUniform4fv(location, 1, &vec[0]);
+/**
+ * \brief reads the whole file with a single read into a buffer of the right size, or copies it out of the shader
+ * archive if one is loaded
+ */
+std::string ShaderCache::read_shader_source(const std::string &path) const {
+    // once hot reloading has seen a file change on disk the archived copy is stale
+    if (shader_archive.is_open() and not shader_paths_modified_on_disk.count(path)) {
+        if (std::optional<std::string_view> archived_source = shader_archive.find(path)) {
+            return std::string(*archived_source);
+        }
+        if (logger_component.logging_enabled) {
+            logger_component.get_logger()->warn("{} is not in the shader archive, reading it from disk", path);
+        }
     }
-}
 
-void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, const std::vector<glm::vec4> &values) {
-    use_shader_program(type);
-    GLint location = get_uniform_location(type, uniform);
-    if (location == -1) {
-        fprintf(stderr, "Uniform '%s' not found in shader program.\n", get_uniform_name(uniform).c_str());
-        return;
+    std::string shader_code;
+
+    std::error_code error;
+    std::uintmax_t file_size = std::filesystem::file_size(path, error);
+    std::ifstream shader_file(path, std::ios::binary);
+    if (error or not shader_file) {
+        if (logger_component.logging_enabled) {
+            logger_component.get_logger()->error("ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ {}: {}", path,
+                                                 error ? error.message() : "could not open the file");
+        }
+        return shader_code;
     }
 
-    // Ensure the vector is not empty to avoid invalid calls
-    if (values.empty()) {
-        fprintf(stderr, "Warning: Attempting to set an empty vec4 array for uniform '%s'.\n",
-                get_uniform_name(uniform).c_str());
-        return;
+    shader_code.resize(static_cast<std::size_t>(file_size));
+    shader_file.read(shader_code.data(), static_cast<std::streamsize>(file_size));
+    if (not shader_file) {
+        if (logger_component.logging_enabled) {
+            logger_component.get_logger()->error("ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ {}: short read", path);
+        }
+        shader_code.clear();
     }
 
-    // Set the uniform array of vec4s
-    glUniform4fv(location, static_cast<GLsizei>(values.size()), glm::value_ptr(values[0]));
+    return shader_code;
 }
 
-void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, float x, float y, float z, float w) {
-    use_shader_program(type);
-    GLint location = get_uniform_location(type, uniform);
-    if (location != -1) {
-        glUniform4f(location, x, y, z, w);
-    }
+/**
+ * \brief the source of a shader file with every #include "file" directive replaced by the contents of that file
+ *
+ * \details files are only read from disk once and their expansions are memoized, included paths are relative to the
+ * file doing the including. Every included body is wrapped in #line directives, so compile errors give the line
+ * within the file they are in. This is safe to call from more than one thread.
+ */
+std::string ShaderCache::get_shader_source(const std::string &path) const {
+    std::lock_guard<std::mutex> lock(shader_source_cache_mutex);
+    std::vector<std::string> include_stack;
+    return get_expanded_shader_source_locked(path, include_stack).source;
 }
 
-void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::mat2 &mat) {
-    use_shader_program(type);
-    GLint location = get_uniform_location(type, uniform);
-    if (location != -1) {
-        glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
-    }
+/**
+ * \return the file itself followed by every file it includes, directly or not
+ */
+std::vector<std::string> ShaderCache::get_shader_source_dependencies(const std::string &path) const {
+    std::lock_guard<std::mutex> lock(shader_source_cache_mutex);
+    std::vector<std::string> include_stack;
+    return get_expanded_shader_source_locked(path, include_stack).dependencies;
 }
 
-void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::mat3 &mat) {
-    use_shader_program(type);
-    GLint location = get_uniform_location(type, uniform);
-    if (location != -1) {
-        glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+/**
+ * \pre shader_source_cache_mutex is held
+ */
+const ExpandedShaderSource &
+ShaderCache::get_expanded_shader_source_locked(const std::string &path, std::vector<std::string> &include_stack) const {
+    auto expanded_it = expanded_shader_sources.find(path);
+    if (expanded_it != expanded_shader_sources.end()) {
+        return expanded_it->second;
     }
-}
 
-void ShaderCache::set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::mat4 &mat) {
-    use_shader_program(type);
-    GLint location = get_uniform_location(type, uniform);
-    if (location != -1) {
-        glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+    auto raw_it = raw_shader_sources.find(path);
+    if (raw_it == raw_shader_sources.end()) {
+        raw_it = raw_shader_sources.emplace(path, read_shader_source(path)).first;
     }
-}
+    const std::string &raw_source = raw_it->second;
+
+    ExpandedShaderSource expanded;
+    expanded.source.reserve(raw_source.size());
+    expanded.dependencies.push_back(path);
+    include_stack.push_back(path);
+
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    std::size_t line_start = 0;
+    std::size_t line_number = 0;
+    while (line_start < raw_source.size()) {
+        std::size_t line_end = raw_source.find('\n', line_start);
+        if (line_end == std::string::npos) {
+            line_end = raw_source.size();
+        }
+        std::string_view line(raw_source.data() + line_start, line_end - line_start);
+        line_start = line_end + 1;
+        line_number++;
+
+        std::optional<std::string> include = parse_shader_include_directive(line);
+        if (not include) {
+            expanded.source.append(line);
+            expanded.source.push_back('\n');
+            continue;
+        }
 
-GLuint ShaderCache::attach_shader(GLuint program, const std::string &path, GLenum shader_type) {
-    std::string shader_code;
-    std::ifstream shader_file;
+        std::string included_path = (directory / *include).lexically_normal().string();
+        if (std::find(include_stack.begin(), include_stack.end(), included_path) != include_stack.end()) {
+            if (logger_component.logging_enabled) {
+                logger_component.get_logger()->error("{} includes itself through {}, skipping it", included_path,
+                                                     path);
+            }
+            expanded.source += "#line " + std::to_string(line_number + 1) + "\n";
+            continue;
+        }
 
-    shader_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        const ExpandedShaderSource &included = get_expanded_shader_source_locked(included_path, include_stack);
+        expanded.source += "#line 1\n";
+        expanded.source.append(included.source);
+        expanded.source += "#line " + std::to_string(line_number + 1) + "\n";
+        for (const std::string &dependency : included.dependencies) {
+            if (std::find(expanded.dependencies.begin(), expanded.dependencies.end(), dependency) ==
+                expanded.dependencies.end()) {
+                expanded.dependencies.push_back(dependency);
+            }
+        }
+    }
 
-    try {
-        shader_file.open(path);
-        std::stringstream shader_stream;
-        shader_stream << shader_file.rdbuf();
-        shader_file.close();
+    include_stack.pop_back();
+    return expanded_shader_sources.emplace(path, std::move(expanded)).first->second;
+}
 
-        shader_code = shader_stream.str();
-    } catch (const std::ifstream::failure &e) {
+/**
+ * \brief forgets everything cached about the file, including expansions and shader objects of files that include it,
+ * so that the next time it is needed it is read from disk again
+ */
+void ShaderCache::invalidate_shader_source(const std::string &path) {
+    std::lock_guard<std::mutex> lock(shader_source_cache_mutex);
+    raw_shader_sources.erase(path);
+    shader_paths_modified_on_disk.insert(path);
+
+    std::vector<std::string> affected_paths = {path};
+    for (auto it = expanded_shader_sources.begin(); it != expanded_shader_sources.end();) {
+        const std::vector<std::string> &dependencies = it->second.dependencies;
+        if (std::find(dependencies.begin(), dependencies.end(), path) == dependencies.end()) {
+            ++it;
+            continue;
+        }
+        affected_paths.push_back(it->first);
+        it = expanded_shader_sources.erase(it);
+    }
 
-        if (logger_component.logging_enabled) {
-            logger_component.get_logger()->error("ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ {}: {}", path, e.what());
+    // pipelines that haven't been reloaded yet still use the old stage programs, so those are only deleted at the end
+    for (auto it = separable_stage_programs.begin(); it != separable_stage_programs.end();) {
+        const std::string &stage_path = std::get<1>(it->first);
+        if (std::find(affected_paths.begin(), affected_paths.end(), stage_path) != affected_paths.end()) {
+            retired_separable_stage_programs.push_back(it->second);
+            it = separable_stage_programs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // programs that are already linked don't need their shader objects anymore, deleting them is safe
+    for (auto it = compiled_shader_objects.begin(); it != compiled_shader_objects.end();) {
+        const std::string &shader_path = std::get<1>(it->first);
+        if (std::find(affected_paths.begin(), affected_paths.end(), shader_path) != affected_paths.end()) {
+            glDeleteShader(it->second);
+            it = compiled_shader_objects.erase(it);
+        } else {
+            ++it;
         }
     }
+}
+
+/**
+ * \brief the file exactly as it is on disk, cached the same way as get_shader_source but without expanding includes
+ */
+std::string ShaderCache::get_raw_shader_source(const std::string &path) const {
+    std::lock_guard<std::mutex> lock(shader_source_cache_mutex);
+    auto it = raw_shader_sources.find(path);
+    if (it == raw_shader_sources.end()) {
+        it = raw_shader_sources.emplace(path, read_shader_source(path)).first;
+    }
+    return it->second;
+}
+
+/**
+ * \brief creates a shader from a SPIR-V module with glShaderBinary and specializes its main entry point, errors show up
+ * in the compile status just like they do for GLSL
+ */
+GLuint ShaderCache::load_spirv_shader(const ShaderStageSource &stage_source) const {
+    GLuint shader = glCreateShader(stage_source.stage);
+    glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V_ARB, stage_source.source.data(),
+                   static_cast<GLsizei>(stage_source.source.size()));
+
+    std::vector<GLuint> constant_ids;
+    std::vector<GLuint> constant_values;
+    for (const SpecializationConstant &constant : stage_source.specialization_constants) {
+        constant_ids.push_back(constant.constant_id);
+        constant_values.push_back(constant.value);
+    }
+    // glad only loads the core entry point on 4.6, a context that only has the extension needs the ARB one
+    if (GLAD_GL_VERSION_4_6) {
+        glSpecializeShader(shader, "main", static_cast<GLuint>(constant_ids.size()), constant_ids.data(),
+                           constant_values.data());
+    } else {
+        glSpecializeShaderARB(shader, "main", static_cast<GLuint>(constant_ids.size()), constant_ids.data(),
+                              constant_values.data());
+    }
+    return shader;
+}
+
+/**
+ * \brief compiles a stage only the first time it is needed, every program with the same stage file attaches the same
+ * shader object
+ */
+GLuint ShaderCache::get_compiled_shader_object(const ShaderStageSource &stage_source,
+                                               ShaderStageBuildStatistics &stage_statistics) {
+    stage_statistics.stage = stage_source.stage;
+    stage_statistics.path = stage_source.path;
+
+    std::lock_guard<std::mutex> lock(shader_source_cache_mutex);
+    auto key = std::make_tuple(stage_source.stage, stage_source.path, stage_source.variant);
+    auto it = compiled_shader_objects.find(key);
+    if (it != compiled_shader_objects.end()) {
+        stage_statistics.reused = true;
+        return it->second;
+    }
 
+    auto compile_start = std::chrono::steady_clock::now();
+    GLuint shader = stage_source.spirv ? load_spirv_shader(stage_source)
+                                       : compile_shader(stage_source.source, stage_source.stage);
+    stage_statistics.compile_time = elapsed_microseconds(compile_start);
+    compiled_shader_objects.emplace(key, shader);
+    return shader;
+}
+
+/**
+ * \brief issues the compile, the compile status is checked later so that the driver is free to compile in the
+ * background
+ */
+GLuint ShaderCache::compile_shader(const std::string &shader_code, GLenum shader_type) const {
     GLuint shader = glCreateShader(shader_type);
     const char *shader_code_ptr = shader_code.c_str();
     glShaderSource(shader, 1, &shader_code_ptr, nullptr);
     glCompileShader(shader);
+    return shader;
+}
 
+/**
+ * \param path only used for error messages
+ * \return true if the shader compiled successfully
+ */
+bool ShaderCache::check_shader_compile_status(GLuint shader, const std::string &path) const {
     GLint success;
     GLchar info_log[1024];
     glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
@@ -390,14 +3530,13 @@ GLuint ShaderCache::attach_shader(GLuint program, const std::string &path, GLenu
             logger_component.get_logger()->error("ERROR::SHADER::COMPILATION_FAILED {}: {}", path, info_log);
         }
     }
-
-    glAttachShader(program, shader);
-    return shader;
+    return success;
 }
 
-void ShaderCache::link_program(GLuint program) {
-    glLinkProgram(program);
-
+/**
+ * \return true if the program linked successfully
+ */
+bool ShaderCache::check_program_link_status(GLuint program) const {
     GLint success;
     GLchar info_log[1024];
     glGetProgramiv(program, GL_LINK_STATUS, &success);
@@ -412,19 +3551,189 @@ void ShaderCache::link_program(GLuint program) {
             logger_component.get_logger()->info("Successfully linked shader program");
         }
     }
+    return success;
 }
 
 void ShaderCache::log_shader_program_info() const {
 
     if (logger_component.logging_enabled) {
         logger_component.get_logger()->info("Logging Created Shaders:");
-        logger_component.get_logger()->info("Total shaders: {}", created_shaders.size());
+        logger_component.get_logger()->info(
+            "Total shaders: {}", std::count(created_shader_alive.begin(), created_shader_alive.end(), true));
+        logger_component.get_logger()->info("Cached shader variants: {}", shader_variants.size());
     }
 
-    for (const auto &[shader_type, shader_info] : created_shaders) {
-        if (logger_component.logging_enabled) {
+    for (std::size_t i = 0; i < created_shaders.size(); i++) {
+        if (created_shader_alive[i] and logger_component.logging_enabled) {
             logger_component.get_logger()->info("Shader Type: {}, Program ID: {}",
-                                                shader_standard.shader_type_to_name.at(shader_type), shader_info.id);
+                                                shader_standard.shader_type_to_name.at(static_cast<ShaderType>(i)),
+                                                created_shaders[i].info.id);
+        }
+    }
+
+    if (not logger_component.logging_enabled or shader_program_build_statistics.empty()) {
+        return;
+    }
+
+    // slowest first, those are the ones worth looking at
+    logger_component.get_logger()->info("Shader build times:");
+    for (const ShaderProgramBuildStatistics *statistics : get_shader_program_build_statistics_by_total_time()) {
+        std::chrono::microseconds compile_time{0};
+        for (const ShaderStageBuildStatistics &stage : statistics->stages) {
+            compile_time += stage.compile_time;
+        }
+        logger_component.get_logger()->info(
+            "{} (variant {}): total {}us, read {}us, compile {}us, link {}us, binary cache {}",
+            shader_standard.shader_type_to_name.at(statistics->type), statistics->variant_key,
+            statistics->get_total_time().count(), statistics->source_read_time.count(), compile_time.count(),
+            statistics->link_time.count(),
+            not statistics->binary_cache_enabled ? "off" : (statistics->binary_cache_hit ? "hit" : "miss"));
+    }
+}
+
+/**
+ * \brief one entry for every program that has been built, in the order they were built
+ */
+const std::vector<ShaderProgramBuildStatistics> &ShaderCache::get_shader_program_build_statistics() const {
+    return shader_program_build_statistics;
+}
+
+std::vector<const ShaderProgramBuildStatistics *>
+ShaderCache::get_shader_program_build_statistics_by_total_time() const {
+    std::vector<const ShaderProgramBuildStatistics *> sorted_statistics;
+    for (const ShaderProgramBuildStatistics &statistics : shader_program_build_statistics) {
+        sorted_statistics.push_back(&statistics);
+    }
+    std::stable_sort(sorted_statistics.begin(), sorted_statistics.end(),
+                     [](const ShaderProgramBuildStatistics *a, const ShaderProgramBuildStatistics *b) {
+                         return a->get_total_time() > b->get_total_time();
+                     });
+    return sorted_statistics;
+}
+
+/**
+ * \brief escapes the characters that can't appear as is in a json string, that is quotes, backslashes and every control
+ * character, shader names and paths rarely have any
+ */
+std::string escape_json_string(const std::string &value) {
+    std::string escaped;
+    for (char c : value) {
+        switch (c) {
+        case '"':
+            escaped += "\\\"";
+            break;
+        case '\\':
+            escaped += "\\\\";
+            break;
+        case '\n':
+            escaped += "\\n";
+            break;
+        case '\r':
+            escaped += "\\r";
+            break;
+        case '\t':
+            escaped += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                std::ostringstream code;
+                code << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c);
+                escaped += code.str();
+            } else {
+                escaped += c;
+            }
+        }
+    }
+    return escaped;
+}
+
+/**
+ * \brief quotes a csv field, doubling the quotes inside it so that commas and quotes in names and paths survive
+ */
+std::string quote_csv_field(const std::string &value) {
+    std::string quoted = "\"";
+    for (char c : value) {
+        quoted += c == '"' ? "\"\"" : std::string(1, c);
+    }
+    return quoted + "\"";
+}
+
+/**
+ * \brief the build statistics sorted slowest first, as an array of objects with all times in microseconds
+ */
+std::string ShaderCache::get_shader_program_build_statistics_as_json() const {
+    std::string json = "[";
+    bool first_program = true;
+    for (const ShaderProgramBuildStatistics *statistics : get_shader_program_build_statistics_by_total_time()) {
+        json += first_program ? "\n" : ",\n";
+        first_program = false;
+
+        const std::string &shader_name = shader_standard.shader_type_to_name.at(statistics->type);
+        json += "  {\"shader\": \"" + escape_json_string(shader_name) + "\"";
+        json += ", \"variant\": " + std::to_string(statistics->variant_key);
+        json += ", \"total_us\": " + std::to_string(statistics->get_total_time().count());
+        json += ", \"read_us\": " + std::to_string(statistics->source_read_time.count());
+        json += ", \"link_us\": " + std::to_string(statistics->link_time.count());
+        json += ", \"binary_cache_enabled\": " + std::string(statistics->binary_cache_enabled ? "true" : "false");
+        json += ", \"binary_cache_hit\": " + std::string(statistics->binary_cache_hit ? "true" : "false");
+        json += ", \"linked\": " + std::string(statistics->linked ? "true" : "false");
+        json += ", \"stages\": [";
+        for (std::size_t i = 0; i < statistics->stages.size(); i++) {
+            const ShaderStageBuildStatistics &stage = statistics->stages[i];
+            json += i == 0 ? "" : ", ";
+            json += "{\"stage\": " + std::to_string(stage.stage);
+            json += ", \"path\": \"" + escape_json_string(stage.path) + "\"";
+            json += ", \"compile_us\": " + std::to_string(stage.compile_time.count());
+            json += ", \"reused\": " + std::string(stage.reused ? "true" : "false") + "}";
+        }
+        json += "]}";
+    }
+    json += "\n]\n";
+    return json;
+}
+
+/**
+ * \brief the build statistics sorted slowest first, one row per stage so that the program columns repeat, all times
+ * are in microseconds
+ */
+std::string ShaderCache::get_shader_program_build_statistics_as_csv() const {
+    std::string csv = "shader,variant,total_us,read_us,link_us,binary_cache_enabled,binary_cache_hit,linked,stage,path,"
+                      "compile_us,reused\n";
+    for (const ShaderProgramBuildStatistics *statistics : get_shader_program_build_statistics_by_total_time()) {
+        std::string program_columns = quote_csv_field(shader_standard.shader_type_to_name.at(statistics->type)) + "," +
+                                      std::to_string(statistics->variant_key) + "," +
+                                      std::to_string(statistics->get_total_time().count()) + "," +
+                                      std::to_string(statistics->source_read_time.count()) + "," +
+                                      std::to_string(statistics->link_time.count()) + "," +
+                                      std::to_string(statistics->binary_cache_enabled) + "," +
+                                      std::to_string(statistics->binary_cache_hit) + "," +
+                                      std::to_string(statistics->linked) + ",";
+        // a program loaded from the binary cache has no stages but still gets a row
+        if (statistics->stages.empty()) {
+            csv += program_columns + ",,,\n";
+        }
+        for (const ShaderStageBuildStatistics &stage : statistics->stages) {
+            csv += program_columns + std::to_string(stage.stage) + "," + quote_csv_field(stage.path) + "," +
+                   std::to_string(stage.compile_time.count()) + "," + std::to_string(stage.reused) + "\n";
+        }
+    }
+    return csv;
+}
+
+/**
+ * \brief writes the build statistics to a file, as csv if the path ends in .csv and as json otherwise
+ *
+ * \return false if the file could not be written
+ */
+bool ShaderCache::write_shader_program_build_statistics(const std::string &path) const {
+    bool csv = std::filesystem::path(path).extension() == ".csv";
+    std::ofstream file(path, std::ios::binary);
+    if (not file) {
+        if (logger_component.logging_enabled) {
+            logger_component.get_logger()->error("Could not write the shader build statistics to {}", path);
         }
+        return false;
     }
+    file << (csv ? get_shader_program_build_statistics_as_csv() : get_shader_program_build_statistics_as_json());
+    return static_cast<bool>(file);
 }
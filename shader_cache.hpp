@@ -2,12 +2,396 @@
 #define SHADER_CACHE_HPP
 
 #include <glm/glm.hpp>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <stdexcept>
 #include <glad/glad.h>
 #include <spdlog/spdlog.h>
 #include "sbpt_generated_includes.hpp"
+#include "shader_archive.hpp"
+
+class UniformBatch;
+class UniformRecorder;
+class MaterialInstance;
+
+/**
+ * \brief the last value written to a uniform through the cache
+ *
+ * \details values up to the size of a mat4 are kept inline so that comparing them is a memcmp on aligned memory, only
+ * bigger values like vec4 arrays go into array_value
+ */
+struct UniformShadow {
+    alignas(16) std::array<unsigned char, sizeof(glm::mat4)> value{};
+    std::vector<unsigned char> array_value;
+    std::size_t size = 0;
+    bool valid = false;
+};
+
+/**
+ * \brief a hit is a write that was dropped because the uniform already had that value, a miss is a write that went
+ * through to the driver
+ */
+struct UniformShadowStatistics {
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+};
+
+/**
+ * \brief how a drawable stores its vertex data, either one buffer per attribute or everything in one buffer
+ */
+enum class VertexBufferLayout { SEPARATE_BUFFERS, INTERLEAVED };
+
+struct VertexFormatAttribute {
+    GLint location = -1;
+    GLuint binding_index = 0;
+    GLuint relative_offset = 0;
+    GLVertexAttributeConfiguration config;
+};
+
+/**
+ * \brief the vertex format of a shader expressed as glVertexAttribFormat/glVertexAttribBinding state, binding_strides
+ * holds the stride of each vertex buffer binding point
+ */
+struct VertexFormat {
+    bool computed = false;
+    std::vector<VertexFormatAttribute> attributes;
+    std::vector<GLsizei> binding_strides;
+};
+
+/**
+ * \brief a source file of a program along with when it was last changed, used for hot reloading
+ */
+struct WatchedShaderFile {
+    std::filesystem::path path;
+    std::filesystem::file_time_type last_write_time;
+};
+
+/**
+ * \brief sets the SPIR-V specialization constant with the given constant_id, the value is the bit pattern of the
+ * constant so floats have to be passed through something like glm::floatBitsToUint
+ */
+struct SpecializationConstant {
+    GLuint constant_id;
+    GLuint value;
+};
+
+/**
+ * \brief the source of a single stage of a program, path is kept for error messages
+ *
+ * \details for SPIR-V stages source holds the binary module. variant describes whatever went into the stage besides
+ * the file, so that two stages built from the same file differently never share a shader object
+ */
+struct ShaderStageSource {
+    GLenum stage;
+    std::string path;
+    std::string source;
+    bool spirv = false;
+    std::vector<SpecializationConstant> specialization_constants;
+    std::string variant;
+    /// how long getting the source took, near zero when it was already cached
+    std::chrono::microseconds read_time{0};
+};
+
+/**
+ * \brief a bitmask where bit i turns on the i-th define of ShaderCacheOptions::shader_variant_defines, 0 is the plain
+ * shader as it is in the catalog
+ */
+using ShaderVariantKey = std::uint32_t;
+
+/**
+ * \brief how one stage of a program was built, reused is set when an already compiled shader object was shared
+ *
+ * \details compile_time is the time spent in the compile calls, which depends on the driver: many compile right there,
+ * others only when the status is first queried which then shows up in the link time of the program
+ */
+struct ShaderStageBuildStatistics {
+    GLenum stage;
+    std::string path;
+    std::chrono::microseconds compile_time{0};
+    bool reused = false;
+};
+
+/**
+ * \brief where the time went when building one program, one is recorded every time a program gets built including
+ * variants and hot reloads
+ *
+ * \details link_time runs from issuing the link to the link status being known, so with KHR_parallel_shader_compile it
+ * is the latency of the build and not time that the calling thread was blocked. On a binary cache hit it is the time
+ * taken by glProgramBinary instead
+ */
+struct ShaderProgramBuildStatistics {
+    ShaderType type;
+    ShaderVariantKey variant_key = 0;
+    std::chrono::microseconds source_read_time{0};
+    std::vector<ShaderStageBuildStatistics> stages;
+    std::chrono::microseconds link_time{0};
+    bool binary_cache_enabled = false;
+    bool binary_cache_hit = false;
+    bool linked = false;
+
+    std::chrono::microseconds get_total_time() const;
+};
+
+bool is_spirv_shader_path(const std::string &path);
+
+/**
+ * \brief a shader file with its includes resolved, dependencies lists the file and everything it includes
+ */
+struct ExpandedShaderSource {
+    std::string source;
+    std::vector<std::string> dependencies;
+};
+
+/**
+ * \brief one stage of a program pipeline, a separable program that any number of pipelines can share
+ */
+struct SeparableStage {
+    GLenum stage;
+    GLuint program;
+    /// indexed by ShaderUniformVariable, the locations within this stage's program
+    std::vector<GLint> uniform_locations;
+};
+
+/**
+ * \brief the state the shader cache keeps for every program it has created
+ *
+ * \details ShaderProgramInfo is owned by the shader standard, so anything extra the cache figures out about a program
+ * when it is created lives here next to it
+ */
+struct CachedShaderProgram {
+    ShaderProgramInfo info;
+    /// indexed by ShaderUniformVariable, holds -1 for uniforms that are not active in the program
+    std::vector<GLint> uniform_locations;
+    /// indexed by ShaderVertexAttributeVariable, holds -1 for attributes that are not active in the program
+    std::vector<GLint> attribute_locations;
+
+    /// indexed by VertexBufferLayout
+    std::array<VertexFormat, 2> vertex_formats;
+    std::array<GLuint, 2> shared_vertex_format_vaos{};
+
+    /// only filled in when hot reloading is enabled
+    std::vector<WatchedShaderFile> watched_files;
+
+    bool uniform_shadowing_enabled = false;
+    /// indexed by ShaderUniformVariable, empty while shadowing is disabled
+    std::vector<UniformShadow> uniform_shadows;
+    UniformShadowStatistics uniform_shadow_statistics;
+    /// indexed by ShaderUniformVariable, the first texture unit given to a sampler uniform or -1 if it isn't one,
+    /// arrays of samplers get one unit per element starting there
+    std::vector<GLint> sampler_texture_units;
+    /// the texture target that matches the type of each sampler, like GL_TEXTURE_2D for a sampler2D
+    std::vector<GLenum> sampler_texture_targets;
+    /// non-zero when the program is a program pipeline assembled from separable stages, info.id holds the pipeline too
+    GLuint pipeline = 0;
+    /// the stages of the pipeline, uniform_locations above then holds the location in whichever stage has the uniform
+    std::vector<SeparableStage> separable_stages;
+    /// the local size the compute shader was declared with, all zero for programs that aren't compute programs
+    std::array<GLint, 3> compute_work_group_size{};
+    /// the id of the MaterialInstance whose values the program holds, 0 once anything else writes a uniform
+    std::uint64_t last_applied_material = 0;
+    /// unique for every program the cache builds, unlike gl names which get reused and differ between programs and
+    /// pipelines
+    std::uint64_t build_id = 0;
+};
+
+/**
+ * \brief counts how often use_shader_program actually had to call glUseProgram, a bind is skipped when the requested
+ * program is already the bound one
+ */
+struct ProgramBindStatistics {
+    std::size_t issued_binds = 0;
+    std::size_t skipped_binds = 0;
+};
+
+/**
+ * \brief a uniform buffer shared by every program that declares a uniform block with the given name, see
+ * ShaderCache::create_shared_uniform_block
+ */
+struct SharedUniformBlock {
+    std::string block_name;
+    GLuint binding_point = 0;
+    /// the size of one copy of the block, aligned_size is that rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    std::size_t size = 0;
+    std::size_t aligned_size = 0;
+    std::size_t ring_length = 0;
+    std::size_t current_slot = 0;
+    GLuint buffer = 0;
+    /// null when the context has no buffer storage, then updates go through glBufferSubData
+    unsigned char *mapped = nullptr;
+    /// one per slot in the ring, set once the gpu may be reading from that slot
+    std::vector<GLsync> slot_fences;
+};
+
+using SharedUniformBlockHandle = std::size_t;
+
+/**
+ * \brief per instance data for instanced draws, one element of an array in a shader storage block, see
+ * ShaderCache::create_instance_data_buffer
+ */
+struct InstanceDataBuffer {
+    std::string block_name;
+    GLuint binding_point = 0;
+    /// the size of one element of the array, the data has to match the std430 layout of the element, or std140 for a
+    /// uniform block where this is rounded up to a multiple of 16
+    std::size_t instance_size = 0;
+    std::size_t capacity = 0;
+    /// what the buffer will hold after the next flush
+    std::vector<unsigned char> data;
+    std::vector<bool> slot_used;
+    std::vector<std::size_t> free_slots;
+    /// one past the highest slot ever handed out, this is the instance count to draw with
+    std::size_t slot_count = 0;
+    /// the slots written since the last flush are all in [dirty_begin, dirty_end)
+    std::size_t dirty_begin = 0;
+    std::size_t dirty_end = 0;
+    /// without shader storage buffers the data goes into a uniform block holding an array instead
+    GLenum target = GL_SHADER_STORAGE_BUFFER;
+    /// how many slots fit in GL_MAX_UNIFORM_BLOCK_SIZE for a uniform block, shader storage buffers have no real limit
+    std::size_t max_capacity = SIZE_MAX;
+    GLuint buffer = 0;
+};
+
+using InstanceDataBufferHandle = std::size_t;
+
+/**
+ * \brief the buffer that holds the data for one vertex attribute of a drawable
+ */
+struct VertexAttributeBufferBinding {
+    ShaderVertexAttributeVariable variable;
+    GLuint vertex_buffer_object;
+};
+
+/**
+ * \brief where one attribute lives inside of an interleaved vertex
+ */
+struct InterleavedVertexAttribute {
+    ShaderVertexAttributeVariable variable;
+    /// bytes from the start of the vertex
+    std::size_t offset;
+    std::size_t size;
+};
+
+/**
+ * \brief every attribute of a vertex packed next to each other in one buffer, see
+ * ShaderCache::compute_interleaved_vertex_layout
+ */
+struct InterleavedVertexLayout {
+    std::vector<InterleavedVertexAttribute> attributes;
+    GLsizei stride = 0;
+};
+
+std::size_t get_size_of_gl_data_type(GLenum data_type);
+GLenum get_texture_target_for_sampler_type(GLenum sampler_type);
+GLbitfield get_program_stage_bit(GLenum stage);
+std::vector<unsigned char> interleave_vertex_data(const InterleavedVertexLayout &layout,
+                                                  const std::vector<const void *> &attribute_data,
+                                                  std::size_t vertex_count);
+
+/**
+ * \brief the element types that set_uniform knows how to upload
+ */
+enum class UniformValueType { INT, FLOAT, VEC2, VEC3, VEC4, MAT2, MAT3, MAT4, TEXTURE_HANDLE };
+constexpr std::size_t uniform_value_type_count = 9;
+
+std::size_t uniform_value_type_size(UniformValueType value_type);
+
+/**
+ * \brief how set_uniform gets values to the driver
+ *
+ * \details BIND_AND_SET binds the program and uses glUniform*, which means that setting a uniform also leaves its
+ * program bound. DIRECT_STATE_ACCESS uses glProgramUniform* and never touches the bound program, so you have to call
+ * use_shader_program yourself before drawing. AUTOMATIC picks direct state access if the context supports it.
+ */
+enum class UniformUploadMode { BIND_AND_SET, DIRECT_STATE_ACCESS, AUTOMATIC };
+
+/**
+ * \brief when the requested shaders get built
+ *
+ * \details IMMEDIATE builds all of them in the constructor. ASYNCHRONOUS submits them to the driver in the constructor
+ * and returns right away, use is_ready or poll_pending_shader_programs to find out when they are done. ON_FIRST_USE
+ * doesn't touch a program until it is needed. Using a program that is not done yet waits for it.
+ */
+enum class ProgramCreationMode { IMMEDIATE, ASYNCHRONOUS, ON_FIRST_USE };
+
+/**
+ * \brief how much state went through the cache, see ShaderCache::begin_frame
+ */
+struct ShaderCacheFrameCounters {
+    std::size_t issued_program_binds = 0;
+    std::size_t skipped_program_binds = 0;
+    /// indexed by UniformValueType, one per glUniform* or glProgramUniform* call
+    std::array<std::size_t, uniform_value_type_count> uniform_uploads{};
+    std::size_t uniform_location_lookups = 0;
+    /// writes that were dropped by uniform shadowing
+    std::size_t redundant_uniform_writes = 0;
+    std::size_t vertex_array_configurations = 0;
+};
+
+struct ShaderCacheFrameStatistics {
+    std::size_t frame_index = 0;
+    ShaderCacheFrameCounters total;
+    /// indexed by ShaderType, only as long as the largest type that had anything counted
+    std::vector<ShaderCacheFrameCounters> per_shader_type;
+};
+
+/**
+ * \brief how long the gpu spent on draws while a shader type was bound, see ShaderCacheOptions::gpu_profiling_enabled
+ *
+ * \details timer results come back a few frames late, last_frame is what arrived during the last frame and
+ * average_frame_time is a rolling average over roughly the last ten frames, which smooths over that
+ */
+struct ShaderGpuTimeStatistics {
+    std::chrono::nanoseconds last_frame{0};
+    double average_frame_time_nanoseconds = 0;
+};
+
+struct ShaderCacheOptions {
+    UniformUploadMode uniform_upload_mode = UniformUploadMode::BIND_AND_SET;
+    ProgramCreationMode program_creation_mode = ProgramCreationMode::IMMEDIATE;
+    /// when non-empty linked programs are stored here with glGetProgramBinary and loaded back on the next run
+    std::string program_binary_cache_directory;
+    /// lets reload_modified_shader_programs rebuild programs whose source files change
+    bool hot_reload_enabled = false;
+    std::chrono::milliseconds hot_reload_poll_interval{500};
+    /// when non-empty shader sources are read out of this archive instead of from individual files, see ShaderArchive.
+    /// With hot reloading on, a file that changes on disk is read from disk from then on
+    std::string shader_archive_path;
+    /// applied to the SPIR-V stages of the given shader types, catalog paths ending in .spv are loaded as SPIR-V
+    std::unordered_map<ShaderType, std::vector<SpecializationConstant>> spirv_specialization_constants;
+    /// times the gpu work done between program switches with GL_TIME_ELAPSED queries, needs GL 3.3 or ARB_timer_query
+    bool gpu_profiling_enabled = false;
+    /// how many queries can be waiting on the gpu at once, when they run out switches go unmeasured instead of stalling
+    std::size_t gpu_profiling_query_count = 64;
+    /// builds every distinct stage once as a separable program and puts the programs of shader types together as
+    /// program pipelines, needs GL 4.1 or ARB_separate_shader_objects. See ShaderCache::use_shader_program
+    bool separable_programs = false;
+    /// compute programs, each built from a single compute shader. ShaderCreationInfo only has the graphics stages so
+    /// they are listed here instead, a type must not be in both this and the shader catalog
+    std::unordered_map<ShaderType, std::string> compute_shader_catalog;
+    /// the names that the bits of a ShaderVariantKey stand for, at most 32 of them
+    std::vector<std::string> shader_variant_defines;
+    /// the most variant programs kept alive at once, the least recently selected ones are deleted past this
+    std::size_t max_cached_shader_variants = 64;
+    /// variants built in the constructor so that selecting them later doesn't stall
+    std::vector<std::pair<ShaderType, ShaderVariantKey>> prewarmed_shader_variants;
+    /// the most programs kept alive at once, past this the least recently used ones are unloaded, 0 means no limit
+    std::size_t max_resident_shader_programs = 0;
+    /// the same but for the combined GL_PROGRAM_BINARY_LENGTH of the programs, an estimate of the driver memory they
+    /// take, needs GL 4.1 or ARB_get_program_binary. 0 means no limit
+    std::size_t resident_shader_program_byte_budget = 0;
+};
 
 /**
  * \brief facilitates simple and robust interaction with shaders
@@ -23,29 +407,78 @@
  */
 class ShaderCache {
   public:
-    ShaderCache(std::vector<ShaderType> requested_shaders, const std::vector<spdlog::sink_ptr> &sinks = {});
+    ShaderCache(std::vector<ShaderType> requested_shaders, const std::vector<spdlog::sink_ptr> &sinks = {},
+                const ShaderCacheOptions &options = {});
     ~ShaderCache();
     ShaderStandard shader_standard;
 
     LoggerComponent logger_component;
 
-    ShaderProgramInfo get_shader_program(ShaderType type) const;
+    const ShaderProgramInfo &get_shader_program(ShaderType type) const;
     void use_shader_program(ShaderType type);
     void stop_using_shader_program();
+    void invalidate_bound_program();
+    bool is_direct_state_access_enabled() const;
+    const ProgramBindStatistics &get_program_bind_statistics() const;
+    void reset_program_bind_statistics();
     void create_shader_program(ShaderType type);
+    void create_shader_programs(const std::vector<ShaderType> &types);
+    bool is_ready(ShaderType type);
+    std::size_t poll_pending_shader_programs();
+    void reload_modified_shader_programs();
+    bool unload_shader_program(ShaderType type);
+    std::size_t get_resident_shader_program_count() const;
+    std::size_t get_resident_shader_program_bytes() const;
+
+    bool is_compute_shader_program(ShaderType type) const;
+    const std::array<GLint, 3> &get_compute_work_group_size(ShaderType type) const;
+    void dispatch(ShaderType type, GLuint num_groups_x, GLuint num_groups_y = 1, GLuint num_groups_z = 1);
+
+    void select_shader_variant(ShaderType type, ShaderVariantKey variant_key);
+    ShaderVariantKey get_selected_shader_variant(ShaderType type) const;
+    void prewarm_shader_variants(const std::vector<std::pair<ShaderType, ShaderVariantKey>> &variants);
+    std::size_t get_cached_shader_variant_count() const;
 
     void configure_vertex_attributes_for_drawables_vao(GLuint vertex_attribute_object, GLuint vertex_buffer_object,
                                                        ShaderType type,
                                                        ShaderVertexAttributeVariable shader_vertex_attribute_variable);
+    void configure_vertex_attributes_for_drawables_vao(
+        GLuint vertex_attribute_object, ShaderType type,
+        const std::vector<VertexAttributeBufferBinding> &vertex_attribute_buffers);
+
+    InterleavedVertexLayout compute_interleaved_vertex_layout(ShaderType type) const;
+    void configure_interleaved_vertex_attributes_for_drawables_vao(GLuint vertex_attribute_object,
+                                                                   GLuint vertex_buffer_object, ShaderType type,
+                                                                   const InterleavedVertexLayout &layout);
+
+    const VertexFormat &get_vertex_format(ShaderType type, VertexBufferLayout layout);
+    void configure_vertex_format_for_vao(GLuint vertex_attribute_object, ShaderType type, VertexBufferLayout layout);
+    GLuint get_shared_vertex_format_vao(ShaderType type, VertexBufferLayout layout);
+    void bind_vertex_buffers_for_drawable(ShaderType type, VertexBufferLayout layout,
+                                          const std::vector<GLuint> &vertex_buffer_objects,
+                                          GLuint element_buffer_object = 0);
+
+    static bool is_frame_instrumentation_enabled();
+    void begin_frame();
+    void end_frame();
+    const ShaderCacheFrameStatistics &get_last_frame_statistics() const;
+    const std::vector<ShaderGpuTimeStatistics> &get_gpu_time_statistics() const;
+    std::size_t get_dropped_gpu_timer_query_count() const;
+    void log_gpu_time_statistics() const;
 
     void log_shader_program_info() const;
+    const std::vector<ShaderProgramBuildStatistics> &get_shader_program_build_statistics() const;
+    std::string get_shader_program_build_statistics_as_json() const;
+    std::string get_shader_program_build_statistics_as_csv() const;
+    bool write_shader_program_build_statistics(const std::string &path) const;
 
-    GLVertexAttributeConfiguration get_gl_vertex_attribute_configuration_for_vertex_attribute_variable(
+    const GLVertexAttributeConfiguration &get_gl_vertex_attribute_configuration_for_vertex_attribute_variable(
         ShaderVertexAttributeVariable shader_vertex_attribute_variable) const;
-    std::vector<ShaderVertexAttributeVariable> get_used_vertex_attribute_variables_for_shader(ShaderType type) const;
-    std::string
+    const std::vector<ShaderVertexAttributeVariable> &
+    get_used_vertex_attribute_variables_for_shader(ShaderType type) const;
+    std::string_view
     get_vertex_attribute_variable_name(ShaderVertexAttributeVariable shader_vertex_attribute_variable) const;
-    std::string get_uniform_name(ShaderUniformVariable uniform) const;
+    std::string_view get_uniform_name(ShaderUniformVariable uniform) const;
     GLint get_uniform_location(ShaderType type, ShaderUniformVariable uniform) const;
 
     void set_uniform(ShaderType type, ShaderUniformVariable uniform, bool value);
@@ -63,11 +496,265 @@ class ShaderCache {
     void set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::mat4 &mat);
     void print_out_active_uniforms_in_shader(ShaderType type);
 
+    void set_uniform_shadowing_enabled(ShaderType type, bool enabled);
+    bool is_uniform_shadowing_enabled(ShaderType type) const;
+    void invalidate_uniform_shadows(ShaderType type);
+    const UniformShadowStatistics &get_uniform_shadow_statistics(ShaderType type) const;
+
+    GLint get_sampler_texture_unit(ShaderType type, ShaderUniformVariable sampler) const;
+    void bind_texture(ShaderType type, ShaderUniformVariable sampler, GLuint texture, std::size_t element = 0);
+    void invalidate_bound_textures();
+    bool is_bindless_texture_supported() const;
+    GLuint64 make_texture_resident(GLuint texture);
+    void make_texture_non_resident(GLuint texture);
+    void set_uniform_texture_handle(ShaderType type, ShaderUniformVariable sampler, GLuint64 handle);
+    void set_uniform_texture_handles(ShaderType type, ShaderUniformVariable sampler,
+                                     const std::vector<GLuint64> &handles);
+
+    InstanceDataBufferHandle create_instance_data_buffer(const std::string &block_name, GLuint binding_point,
+                                                         std::size_t instance_size, std::size_t capacity = 1024);
+    std::size_t allocate_instance_slot(InstanceDataBufferHandle handle);
+    void free_instance_slot(InstanceDataBufferHandle handle, std::size_t slot);
+    void update_instance_data(InstanceDataBufferHandle handle, std::size_t slot, const void *data, std::size_t size);
+    template <typename T> void update_instance_data(InstanceDataBufferHandle handle, std::size_t slot, const T &data) {
+        update_instance_data(handle, slot, &data, sizeof(T));
+    }
+    void flush_instance_data_buffer(InstanceDataBufferHandle handle);
+    std::size_t get_instance_count(InstanceDataBufferHandle handle) const;
+
+    void flush_uniform_batch(UniformBatch &batch);
+    void flush_uniform_recorder(UniformRecorder &recorder);
+    void apply_material_instance(MaterialInstance &material);
+
+    SharedUniformBlockHandle create_shared_uniform_block(const std::string &block_name, GLuint binding_point,
+                                                         std::size_t size, std::size_t ring_length = 3);
+    void update_shared_uniform_block(SharedUniformBlockHandle handle, const void *data, std::size_t size);
+    template <typename T> void update_shared_uniform_block(SharedUniformBlockHandle handle, const T &data) {
+        update_shared_uniform_block(handle, &data, sizeof(T));
+    }
+
   private:
-    GLuint attach_shader(GLuint program, const std::string &path, GLenum shader_type);
-    void link_program(GLuint program);
+    /**
+     * \brief a program whose compiles and link have been issued but not yet checked
+     */
+    struct PendingShaderProgram {
+        ShaderType type;
+        GLuint program = 0;
+        /// the shader objects along with the path they came from, for error messages
+        std::vector<std::pair<GLuint, std::string>> shaders;
+        std::string binary_key;
+        bool loaded_from_binary = false;
+        ShaderProgramBuildStatistics statistics;
+        std::chrono::steady_clock::time_point link_start;
+        /// set when the program is a pipeline, program is 0 until the pipeline is made in complete_shader_program
+        bool separable = false;
+        std::vector<std::pair<GLenum, GLuint>> stage_programs;
+    };
+
+    /**
+     * \brief a program built with some of the variant defines turned on
+     */
+    struct ShaderVariant {
+        CachedShaderProgram program;
+        std::list<std::uint64_t>::iterator lru_position;
+    };
+
+    PendingShaderProgram submit_shader_program(ShaderType type);
+    PendingShaderProgram submit_shader_program(ShaderType type, const std::vector<ShaderStageSource> &stage_sources);
+    std::vector<ShaderStageSource> read_shader_stage_sources(ShaderType type, ShaderVariantKey variant_key = 0) const;
+    ShaderStageSource read_shader_stage_source(ShaderType type, GLenum stage, const std::string &path,
+                                               ShaderVariantKey variant_key) const;
+    std::string inject_shader_variant_defines(const std::string &source, ShaderVariantKey variant_key) const;
+    static std::uint64_t get_shader_variant_id(ShaderType type, ShaderVariantKey variant_key);
+    void check_shader_variant_key(ShaderVariantKey variant_key) const;
+    ShaderVariant &get_or_create_shader_variant(ShaderType type, ShaderVariantKey variant_key);
+    ShaderVariant &add_shader_variant(ShaderType type, ShaderVariantKey variant_key,
+                                      PendingShaderProgram &pending_program);
+    void evict_shader_variants();
+    void release_shader_variants(ShaderType type);
+    std::string resolve_shader_stage_path(const std::string &path) const;
+    bool complete_shader_program(PendingShaderProgram &pending_program);
+    std::vector<WatchedShaderFile> get_watched_shader_files(ShaderType type) const;
+    void swap_in_reloaded_shader_program(ShaderType type, const std::vector<ShaderStageSource> &stage_sources);
+    void release_unused_retired_separable_stage_programs();
+    bool is_shader_program_complete(const PendingShaderProgram &pending_program) const;
+    void finalize_shader_program(PendingShaderProgram &pending_program, bool enforce_budget = true);
+    bool advance_shader_program(ShaderType type, bool wait);
+    bool is_shader_program_created(ShaderType type) const;
+
+    const CachedShaderProgram &get_cached_shader_program(ShaderType type) const;
+    CachedShaderProgram &get_cached_shader_program(ShaderType type);
+    GLint lookup_uniform_location(const CachedShaderProgram &program, ShaderUniformVariable uniform) const;
+    bool uniform_value_unchanged(CachedShaderProgram &program, ShaderUniformVariable uniform, const void *data,
+                                 std::size_t size);
+    void write_uniform(ShaderType type, ShaderUniformVariable uniform, UniformValueType value_type, const void *data,
+                       GLsizei count);
+    void write_uniform_array_elements(ShaderType type, ShaderUniformVariable uniform, UniformValueType value_type,
+                                      GLint first_element, const void *data, GLsizei count);
+    void upload_uniform(GLuint program, GLint location, UniformValueType value_type, const void *data,
+                        GLsizei count) const;
+    bool resolve_direct_state_access(UniformUploadMode uniform_upload_mode) const;
+    void bind_shared_uniform_block(GLuint program, const SharedUniformBlock &block) const;
+    void bind_instance_data_buffer(GLuint program, const InstanceDataBuffer &instance_buffer) const;
+    void allocate_instance_data_storage(InstanceDataBuffer &instance_buffer);
+    std::string read_shader_source(const std::string &path) const;
+    std::string get_shader_source(const std::string &path) const;
+    std::vector<std::string> get_shader_source_dependencies(const std::string &path) const;
+    const ExpandedShaderSource &get_expanded_shader_source_locked(const std::string &path,
+                                                                  std::vector<std::string> &include_stack) const;
+    void invalidate_shader_source(const std::string &path);
+    std::string get_raw_shader_source(const std::string &path) const;
+    GLuint load_spirv_shader(const ShaderStageSource &stage_source) const;
+    GLuint get_compiled_shader_object(const ShaderStageSource &stage_source,
+                                      ShaderStageBuildStatistics &stage_statistics);
+    std::vector<const ShaderProgramBuildStatistics *> get_shader_program_build_statistics_by_total_time() const;
+    GLuint compile_shader(const std::string &shader_code, GLenum shader_type) const;
+    bool check_shader_compile_status(GLuint shader, const std::string &path) const;
+    bool check_program_link_status(GLuint program) const;
+    CachedShaderProgram build_cached_shader_program(ShaderType type, const PendingShaderProgram &pending_program);
+    bool is_cached_shader_program_bound(const CachedShaderProgram &program) const;
+    void register_created_shader_program(ShaderType type, const PendingShaderProgram &pending_program,
+                                         bool enforce_budget = true);
+    void touch_resident_shader_program(ShaderType type);
+    void forget_resident_shader_program(ShaderType type);
+    void evict_resident_shader_programs(std::optional<ShaderType> protected_type);
+    bool is_over_resident_shader_program_budget() const;
+    GLuint get_separable_stage_program(const ShaderStageSource &stage_source, GLuint shader);
+    static std::vector<GLuint> get_linked_programs(const CachedShaderProgram &program);
+    void upload_cached_program_uniform(CachedShaderProgram &program, ShaderUniformVariable uniform, GLint first_element,
+                                       UniformValueType value_type, const void *data, GLsizei count);
+    void upload_program_uniform(GLuint program, GLint location, UniformValueType value_type, const void *data,
+                                GLsizei count) const;
+    void release_cached_shader_program(CachedShaderProgram &program);
+    ShaderCacheFrameCounters &get_frame_counters(ShaderType type) const;
+    void begin_gpu_timer_query(ShaderType type);
+    void end_gpu_timer_query();
+    bool read_gpu_timer_query(std::size_t query_index);
+    void update_gpu_time_statistics();
+    void count_frame_event(ShaderType type, std::size_t ShaderCacheFrameCounters::*counter) const;
+    void count_uniform_upload(ShaderType type, UniformValueType value_type) const;
+
+    bool initialize_program_binary_cache(const std::string &directory);
+    std::string compute_program_binary_key(const std::vector<std::string> &stage_sources) const;
+    std::filesystem::path get_program_binary_path(const std::string &binary_key) const;
+    bool load_program_binary(GLuint program, const std::string &binary_key);
+    void save_program_binary(GLuint program, const std::string &binary_key);
+    std::vector<GLint> build_uniform_location_table(GLuint program) const;
+    std::vector<GLint> build_attribute_location_table(GLuint program) const;
+    void assign_sampler_texture_units(CachedShaderProgram &program);
+    void remember_sampler_texture_unit(CachedShaderProgram &program, ShaderUniformVariable uniform, GLint unit);
+    void assign_sampler_texture_units(GLuint program_id, const std::vector<GLint> &uniform_locations, GLint first_unit,
+                                      GLint last_unit, CachedShaderProgram &program);
+    void configure_vertex_attribute(const CachedShaderProgram &program,
+                                    ShaderVertexAttributeVariable shader_vertex_attribute_variable, GLsizei stride,
+                                    const GLvoid *pointer_to_start_of_data);
+
+    /// indexed by ShaderType, an entry only holds a program if its bit in created_shader_alive is set
+    std::vector<CachedShaderProgram> created_shaders;
+    std::vector<bool> created_shader_alive;
+    std::unordered_map<ShaderType, PendingShaderProgram> pending_shader_programs;
+    /// requested with ON_FIRST_USE and not submitted yet, unloaded programs go back in here
+    std::unordered_set<ShaderType> deferred_shader_types;
+
+    std::size_t max_resident_shader_programs = 0;
+    std::size_t resident_shader_program_byte_budget = 0;
+    bool program_size_estimates_enabled = false;
+    /// the created programs, most recently used at the front
+    std::list<ShaderType> resident_shader_program_lru;
+    /// indexed by ShaderType, only meaningful while the program is created
+    std::vector<std::list<ShaderType>::iterator> resident_shader_program_lru_positions;
+    std::vector<std::size_t> resident_shader_program_sizes;
+    std::size_t resident_shader_program_bytes = 0;
+    std::uint64_t next_program_build_id = 1;
+    /// unloaded programs that had uniform shadowing on, it is turned back on when they are created again
+    std::unordered_set<ShaderType> unloaded_shadowed_shader_types;
+    std::unordered_map<std::string, ShaderUniformVariable> uniform_name_to_variable;
+    std::size_t uniform_location_table_size = 0;
+    /// indexed by ShaderUniformVariable and ShaderVertexAttributeVariable, copied out of the shader standard once
+    std::vector<std::string> uniform_names;
+    std::vector<std::string> vertex_attribute_variable_names;
+
+    bool direct_state_access_enabled = false;
+
+    std::vector<SharedUniformBlock> shared_uniform_blocks;
+    std::vector<InstanceDataBuffer> instance_data_buffers;
+
+    bool parallel_shader_compile_supported = false;
+
+    ShaderArchive shader_archive;
+
+    /// guards the source caches below, sources get read from the hot reload threads too
+    mutable std::mutex shader_source_cache_mutex;
+    /// keyed by path, the file exactly as it is on disk and then with its includes resolved
+    mutable std::unordered_map<std::string, std::string> raw_shader_sources;
+    mutable std::unordered_map<std::string, ExpandedShaderSource> expanded_shader_sources;
+    /// paths hot reloading saw change, these skip the shader archive
+    std::unordered_set<std::string> shader_paths_modified_on_disk;
+    /// keyed by stage, path and variant, shared by every program that uses that stage file
+    std::map<std::tuple<GLenum, std::string, std::string>, GLuint> compiled_shader_objects;
+
+    std::vector<std::string> shader_variant_defines;
+    std::size_t max_cached_shader_variants = 0;
+    /// keyed by ShaderType in the high 32 bits and the ShaderVariantKey in the low ones
+    std::unordered_map<std::uint64_t, ShaderVariant> shader_variants;
+    /// most recently selected at the front
+    std::list<std::uint64_t> shader_variant_lru;
+    /// indexed by ShaderType, null while the plain program is selected. Selected variants are never evicted so the
+    /// pointers stay valid, unordered_map never moves its elements
+    std::vector<CachedShaderProgram *> selected_shader_variant_programs;
+    std::vector<ShaderVariantKey> selected_shader_variant_keys;
+
+    std::unordered_map<ShaderType, std::string> compute_shader_catalog;
+
+    bool spirv_supported = false;
+    std::unordered_map<ShaderType, std::vector<SpecializationConstant>> spirv_specialization_constants;
+
+    bool hot_reload_enabled = false;
+    std::chrono::milliseconds hot_reload_poll_interval{0};
+    std::chrono::steady_clock::time_point last_hot_reload_poll;
+    std::unordered_map<ShaderType, std::future<std::vector<ShaderStageSource>>> hot_reloads_in_flight;
+
+    bool program_binary_cache_enabled = false;
+    std::string program_binary_cache_directory;
+    std::string program_binary_driver_identifier;
+    bool separable_programs_enabled = false;
+    /// keyed like compiled_shader_objects
+    std::map<std::tuple<GLenum, std::string, std::string>, GLuint> separable_stage_programs;
+    /// stage programs whose source changed, deleted once every pipeline using them has been reloaded
+    std::vector<GLuint> retired_separable_stage_programs;
+    GLuint currently_bound_pipeline = 0;
+    GLuint currently_bound_program = 0;
+    ProgramBindStatistics program_bind_statistics;
+    /// indexed by texture unit, what bind_texture last put there
+    std::vector<GLuint> bound_textures;
+    bool bindless_texture_supported = false;
+    /// texture id to its bindless handle, for every texture that was made resident through the cache
+    std::unordered_map<GLuint, GLuint64> resident_texture_handles;
+    /// reused by flush_uniform_batch to put the values of neighbouring array element writes next to each other
+    std::vector<unsigned char> uniform_batch_scratch;
+    /// mutable since the const lookups are counted as well
+    mutable ShaderCacheFrameStatistics current_frame_statistics;
+    ShaderCacheFrameStatistics last_frame_statistics;
+
+    /**
+     * \brief one query of the ring, in flight from when it is begun until its result has been read
+     */
+    struct GpuTimerQuery {
+        GLuint query = 0;
+        ShaderType type;
+        bool in_flight = false;
+    };
 
-    std::unordered_map<ShaderType, ShaderProgramInfo> created_shaders;
+    bool gpu_profiling_enabled = false;
+    std::vector<GpuTimerQuery> gpu_timer_queries;
+    std::size_t next_gpu_timer_query = 0;
+    /// the query that is running right now, if any
+    std::optional<std::size_t> active_gpu_timer_query;
+    std::size_t dropped_gpu_timer_queries = 0;
+    /// indexed by ShaderType, the results read since the last end_frame
+    std::vector<std::chrono::nanoseconds> gpu_time_this_frame;
+    std::vector<ShaderGpuTimeStatistics> gpu_time_statistics;
+    std::vector<ShaderProgramBuildStatistics> shader_program_build_statistics;
 };
 
 std::string shader_type_to_string(ShaderType type);
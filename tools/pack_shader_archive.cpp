@@ -0,0 +1,69 @@
+#include "../shader_archive.hpp"
+#include "sbpt_generated_includes.hpp"
+
+#include <filesystem>
+#include <iostream>
+
+/**
+ * \brief packs shader sources into a single archive that ShaderCache can load through
+ * ShaderCacheOptions::shader_archive_path
+ *
+ * \usage pack_shader_archive <output path> [--compute <compute shader>]... [shader files...], run it from the directory
+ * the shader catalog paths are relative to. Without any shader files every source in the shader catalog is packed,
+ * compute shaders aren't part of the catalog so the ones in ShaderCacheOptions::compute_shader_catalog are passed with
+ * --compute. For .spv stages the GLSL file they were compiled from is packed too when it exists, the cache falls back
+ * to it on contexts without SPIR-V. Files pulled in with #include are always packed as well.
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <output path> [--compute <compute shader>]... [shader files...]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> paths;
+    std::vector<std::string> compute_paths;
+    for (int i = 2; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--compute") {
+            if (i + 1 == argc) {
+                std::cerr << "--compute needs a path after it" << std::endl;
+                return 1;
+            }
+            compute_paths.push_back(argv[++i]);
+        } else {
+            paths.push_back(argument);
+        }
+    }
+
+    if (paths.empty()) {
+        ShaderStandard shader_standard;
+        for (const auto &[type, shader_info] : shader_standard.shader_catalog) {
+            for (const std::string &path : {shader_info.vertex_path, shader_info.fragment_path,
+                                            shader_info.geometry_path}) {
+                if (not path.empty()) {
+                    paths.push_back(path);
+                }
+            }
+        }
+    }
+    paths.insert(paths.end(), compute_paths.begin(), compute_paths.end());
+
+    std::vector<std::string> glsl_fallback_paths;
+    for (const std::string &path : paths) {
+        std::filesystem::path stage_path(path);
+        if (stage_path.extension() == ".spv" and std::filesystem::exists(stage_path.replace_extension())) {
+            glsl_fallback_paths.push_back(stage_path.string());
+        }
+    }
+    paths.insert(paths.end(), glsl_fallback_paths.begin(), glsl_fallback_paths.end());
+
+    std::vector<std::string> files = collect_shader_files_with_includes(paths);
+    if (not ShaderArchive::write(argv[1], files)) {
+        std::cerr << "failed to write the shader archive " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::cout << "packed " << files.size() << " shader files into " << argv[1] << std::endl;
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include "uniform_batch.hpp"
+
+#include <cstring>
+
+#include <glm/gtc/type_ptr.hpp>
+
+/**
+ * \param expected_entries how many writes a frame usually records, only used to size the buffers up front
+ */
+UniformBatch::UniformBatch(std::size_t expected_entries) {
+    entries.reserve(expected_entries);
+    arena.reserve(expected_entries * sizeof(glm::vec4));
+}
+
+void UniformBatch::set_uniform(ShaderType type, ShaderUniformVariable uniform, bool value) {
+    set_uniform(type, uniform, static_cast<int>(value));
+}
+
+void UniformBatch::set_uniform(ShaderType type, ShaderUniformVariable uniform, int value) {
+    record(type, uniform, UniformValueType::INT, -1, &value, 1);
+}
+
+void UniformBatch::set_uniform(ShaderType type, ShaderUniformVariable uniform, float value) {
+    record(type, uniform, UniformValueType::FLOAT, -1, &value, 1);
+}
+
+void UniformBatch::set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::vec2 &vec) {
+    record(type, uniform, UniformValueType::VEC2, -1, &vec[0], 1);
+}
+
+void UniformBatch::set_uniform(ShaderType type, ShaderUniformVariable uniform, float x, float y) {
+    set_uniform(type, uniform, glm::vec2(x, y));
+}
+
+void UniformBatch::set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::vec3 &vec) {
+    record(type, uniform, UniformValueType::VEC3, -1, &vec[0], 1);
+}
+
+void UniformBatch::set_uniform(ShaderType type, ShaderUniformVariable uniform, float x, float y, float z) {
+    set_uniform(type, uniform, glm::vec3(x, y, z));
+}
+
+void UniformBatch::set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::vec4 &vec) {
+    record(type, uniform, UniformValueType::VEC4, -1, &vec[0], 1);
+}
+
+void UniformBatch::set_uniform(ShaderType type, ShaderUniformVariable uniform, float x, float y, float z, float w) {
+    set_uniform(type, uniform, glm::vec4(x, y, z, w));
+}
+
+void UniformBatch::set_uniform(ShaderType type, ShaderUniformVariable uniform, const std::vector<glm::vec4> &values) {
+    if (values.empty()) {
+        return;
+    }
+    record(type, uniform, UniformValueType::VEC4, -1, glm::value_ptr(values[0]), static_cast<GLsizei>(values.size()));
+}
+
+void UniformBatch::set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::mat2 &mat) {
+    record(type, uniform, UniformValueType::MAT2, -1, &mat[0][0], 1);
+}
+
+void UniformBatch::set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::mat3 &mat) {
+    record(type, uniform, UniformValueType::MAT3, -1, &mat[0][0], 1);
+}
+
+void UniformBatch::set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::mat4 &mat) {
+    record(type, uniform, UniformValueType::MAT4, -1, &mat[0][0], 1);
+}
+
+/**
+ * \brief writes a single element of a vec4 array uniform, writes to neighbouring elements get uploaded together
+ */
+void UniformBatch::set_uniform_array_element(ShaderType type, ShaderUniformVariable uniform, std::size_t element,
+                                             const glm::vec4 &value) {
+    record(type, uniform, UniformValueType::VEC4, static_cast<GLint>(element), &value[0], 1);
+}
+
+/**
+ * \brief adds every write recorded in other after the ones already in this batch
+ */
+void UniformBatch::append(const UniformBatch &other) {
+    std::uint32_t arena_offset = static_cast<std::uint32_t>(arena.size());
+    std::uint32_t sequence_offset = static_cast<std::uint32_t>(entries.size());
+    arena.insert(arena.end(), other.arena.begin(), other.arena.end());
+    for (UniformBatchEntry entry : other.entries) {
+        entry.offset += arena_offset;
+        entry.sequence += sequence_offset;
+        entries.push_back(entry);
+    }
+}
+
+std::size_t UniformBatch::size() const { return entries.size(); }
+
+bool UniformBatch::empty() const { return entries.empty(); }
+
+/**
+ * \brief drops every recorded write but keeps the memory around for the next frame
+ */
+void UniformBatch::clear() {
+    entries.clear();
+    arena.clear();
+}
+
+void UniformBatch::record(ShaderType type, ShaderUniformVariable uniform, UniformValueType value_type, GLint element,
+                          const void *data, GLsizei count) {
+    std::size_t size = uniform_value_type_size(value_type) * static_cast<std::size_t>(count);
+    std::size_t offset = arena.size();
+    arena.resize(offset + size);
+    std::memcpy(arena.data() + offset, data, size);
+
+    entries.push_back({type, uniform, value_type, count, element, static_cast<std::uint32_t>(offset),
+                       static_cast<std::uint32_t>(entries.size())});
+}
+
+namespace {
+std::atomic<std::uint64_t> next_uniform_recorder_id{1};
+}
+
+UniformRecorder::UniformRecorder() : id(next_uniform_recorder_id.fetch_add(1)) {}
+
+void UniformRecorder::set_uniform_array_element(ShaderType type, ShaderUniformVariable uniform, std::size_t element,
+                                                const glm::vec4 &value) {
+    ThreadBatch &thread_batch = get_thread_batch();
+    std::lock_guard<std::mutex> lock(thread_batch.mutex);
+    thread_batch.batch.set_uniform_array_element(type, uniform, element, value);
+}
+
+/**
+ * \brief moves the writes of every thread into one batch and returns it, the batch stays valid until the next call
+ *
+ * \note threads may keep recording while this runs, whatever they record after their batch was taken is picked up by
+ * the next call
+ */
+UniformBatch &UniformRecorder::collect() {
+    collected.clear();
+    std::lock_guard<std::mutex> lock(thread_batches_mutex);
+    for (std::unique_ptr<ThreadBatch> &thread_batch : thread_batches) {
+        std::lock_guard<std::mutex> batch_lock(thread_batch->mutex);
+        collected.append(thread_batch->batch);
+        thread_batch->batch.clear();
+    }
+    return collected;
+}
+
+/**
+ * \brief the batch of the calling thread, created the first time a thread records through this recorder
+ */
+UniformRecorder::ThreadBatch &UniformRecorder::get_thread_batch() {
+    struct CachedThreadBatch {
+        std::uint64_t recorder_id = 0;
+        ThreadBatch *thread_batch = nullptr;
+    };
+    thread_local CachedThreadBatch cached;
+    if (cached.recorder_id == id) {
+        return *cached.thread_batch;
+    }
+
+    std::lock_guard<std::mutex> lock(thread_batches_mutex);
+    std::thread::id this_thread = std::this_thread::get_id();
+    ThreadBatch *found = nullptr;
+    for (std::unique_ptr<ThreadBatch> &thread_batch : thread_batches) {
+        if (thread_batch->thread == this_thread) {
+            found = thread_batch.get();
+            break;
+        }
+    }
+    if (not found) {
+        thread_batches.push_back(std::make_unique<ThreadBatch>());
+        found = thread_batches.back().get();
+        found->thread = this_thread;
+    }
+
+    cached.recorder_id = id;
+    cached.thread_batch = found;
+    return *found;
+}
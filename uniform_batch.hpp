@@ -0,0 +1,128 @@
+#ifndef UNIFORM_BATCH_HPP
+#define UNIFORM_BATCH_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "shader_cache.hpp"
+
+/**
+ * \brief one recorded write, the value itself lives in the arena of the batch
+ */
+struct UniformBatchEntry {
+    ShaderType type;
+    ShaderUniformVariable uniform;
+    UniformValueType value_type;
+    GLsizei count;
+    /// -1 for a write to the whole uniform, otherwise the array element the write starts at
+    GLint element;
+    /// where the value starts in the arena
+    std::uint32_t offset;
+    /// the order the write was recorded in, later writes win
+    std::uint32_t sequence;
+};
+
+/**
+ * \brief records uniform writes so that they can be handed to the cache all at once with
+ * ShaderCache::flush_uniform_batch, which sorts them by program so that each program is bound only once
+ *
+ * \details values are copied into one arena that is reused between flushes, after the first few frames recording
+ * doesn't allocate at all. If the same uniform is written more than once only the last value is uploaded, writes to
+ * consecutive elements of an array uniform are uploaded with a single call. The result is the same as making the calls
+ * on the cache in the order they were recorded, so a write to the whole uniform replaces element writes made before it
+ *
+ * \usage record with the same set_uniform calls as on the cache, then flush once before drawing
+ */
+class UniformBatch {
+  public:
+    explicit UniformBatch(std::size_t expected_entries = 256);
+
+    void set_uniform(ShaderType type, ShaderUniformVariable uniform, bool value);
+    void set_uniform(ShaderType type, ShaderUniformVariable uniform, int value);
+    void set_uniform(ShaderType type, ShaderUniformVariable uniform, float value);
+    void set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::vec2 &vec);
+    void set_uniform(ShaderType type, ShaderUniformVariable uniform, float x, float y);
+    void set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::vec3 &vec);
+    void set_uniform(ShaderType type, ShaderUniformVariable uniform, float x, float y, float z);
+    void set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::vec4 &vec);
+    void set_uniform(ShaderType type, ShaderUniformVariable uniform, const std::vector<glm::vec4> &values);
+    void set_uniform(ShaderType type, ShaderUniformVariable uniform, float x, float y, float z, float w);
+    void set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::mat2 &mat);
+    void set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::mat3 &mat);
+    void set_uniform(ShaderType type, ShaderUniformVariable uniform, const glm::mat4 &mat);
+    void set_uniform_array_element(ShaderType type, ShaderUniformVariable uniform, std::size_t element,
+                                   const glm::vec4 &value);
+
+    void append(const UniformBatch &other);
+
+    std::size_t size() const;
+    bool empty() const;
+    void clear();
+
+  private:
+    friend class ShaderCache;
+
+    void record(ShaderType type, ShaderUniformVariable uniform, UniformValueType value_type, GLint element,
+                const void *data, GLsizei count);
+
+    std::vector<UniformBatchEntry> entries;
+    std::vector<unsigned char> arena;
+};
+
+/**
+ * \brief lets any number of threads record uniform writes at the same time, the thread that owns the gl context then
+ * collects all of them with ShaderCache::flush_uniform_recorder
+ *
+ * \details every thread records into a batch of its own, so recording threads never wait on each other. Each batch
+ * has a lock that is only ever contended while it is being collected, and a thread finds its batch through a thread
+ * local cache so that recording doesn't touch any shared state. Writes from different threads to the same uniform
+ * land in no particular order
+ *
+ * \usage record on the worker threads with the same set_uniform calls as on the cache, then once they are done for the
+ * frame call ShaderCache::flush_uniform_recorder on the gl thread
+ */
+class UniformRecorder {
+  public:
+    UniformRecorder();
+    UniformRecorder(const UniformRecorder &) = delete;
+    UniformRecorder &operator=(const UniformRecorder &) = delete;
+
+    /// takes whatever UniformBatch::set_uniform takes, which are the same overloads as on the cache
+    template <typename... Values>
+    void set_uniform(ShaderType type, ShaderUniformVariable uniform, const Values &...values) {
+        ThreadBatch &thread_batch = get_thread_batch();
+        std::lock_guard<std::mutex> lock(thread_batch.mutex);
+        thread_batch.batch.set_uniform(type, uniform, values...);
+    }
+
+    void set_uniform_array_element(ShaderType type, ShaderUniformVariable uniform, std::size_t element,
+                                   const glm::vec4 &value);
+
+    UniformBatch &collect();
+
+  private:
+    struct ThreadBatch {
+        std::thread::id thread;
+        std::mutex mutex;
+        UniformBatch batch;
+    };
+
+    ThreadBatch &get_thread_batch();
+
+    /// unique for every recorder ever created, so the thread local cache can't be fooled by a recorder that was
+    /// created at the address of a destroyed one
+    std::uint64_t id;
+    std::mutex thread_batches_mutex;
+    std::vector<std::unique_ptr<ThreadBatch>> thread_batches;
+    /// only touched by the thread that collects
+    UniformBatch collected;
+};
+
+#endif // UNIFORM_BATCH_HPP